@@ -0,0 +1,103 @@
+// Writes FSEQ test sequences. Channel c of frame f holds (f + c) & 0xff, so
+// every LED shows which frame and channel it came from.
+#ifndef FSEQ_FILES_H
+#define FSEQ_FILES_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+struct FSEQFileSpec {
+  uint8_t version = 2;
+  uint32_t channels = 300;
+  uint32_t frames = 100;
+  uint8_t stepTime = 25;
+  bool zlib = false;
+  uint32_t framesPerBlock = 10; // compressed frames per block
+  // sparse ranges (start channel, count), the file stores their channels
+  std::vector<std::pair<uint32_t, uint32_t>> sparse;
+};
+
+inline uint8_t fseqChannelValue(uint32_t frame, uint32_t channel) {
+  return (frame + channel) & 0xff;
+}
+
+inline void fseqPut(std::vector<uint8_t> &out, uint32_t v, uint8_t bytes) {
+  for (uint8_t i = 0; i < bytes; i++)
+    out.push_back(v >> (8 * i));
+}
+
+inline bool writeFSEQFile(const std::string &hostPath,
+                          const FSEQFileSpec &spec) {
+  std::vector<uint8_t> data;
+  std::vector<std::pair<uint32_t, uint32_t>> blocks; // first frame, length
+  std::vector<uint8_t> frame(spec.channels);
+  std::vector<uint8_t> raw;
+  for (uint32_t f = 0; f < spec.frames; f++) {
+    for (uint32_t c = 0; c < spec.channels; c++)
+      frame[c] = fseqChannelValue(f, c);
+    raw.insert(raw.end(), frame.begin(), frame.end());
+    bool blockEnd = (f + 1) % spec.framesPerBlock == 0 || f + 1 == spec.frames;
+    if (!spec.zlib || !blockEnd)
+      continue;
+    uLongf len = compressBound(raw.size());
+    std::vector<uint8_t> packed(len);
+    if (compress(packed.data(), &len, raw.data(), raw.size()) != Z_OK)
+      return false;
+    blocks.push_back({f + 1 - raw.size() / spec.channels, uint32_t(len)});
+    data.insert(data.end(), packed.begin(), packed.begin() + len);
+    raw.clear();
+  }
+  if (!spec.zlib)
+    data = raw;
+
+  std::vector<uint8_t> header;
+  uint32_t headerLength = spec.version == 1 ? 28 : 32;
+  if (spec.version >= 2)
+    headerLength += 8 * (blocks.size() + spec.zlib) + 6 * spec.sparse.size();
+  uint32_t dataOffset = (headerLength + 3) & ~3u;
+  header.insert(header.end(), {'P', 'S', 'E', 'Q'});
+  fseqPut(header, dataOffset, 2);
+  header.push_back(0); // minor version
+  header.push_back(spec.version);
+  fseqPut(header, headerLength, 2);
+  fseqPut(header, spec.channels, 4);
+  fseqPut(header, spec.frames, 4);
+  header.push_back(spec.stepTime);
+  header.push_back(0); // flags
+  if (spec.version == 1) {
+    header.resize(28, 0); // universe settings
+  } else {
+    // one unused trailing block entry, like xLights writes them
+    uint32_t blockCount = blocks.size() + spec.zlib;
+    header.push_back((spec.zlib ? 2 : 0) | ((blockCount >> 4) & 0xF0));
+    header.push_back(blockCount & 0xff);
+    header.push_back(spec.sparse.size());
+    header.push_back(0);
+    fseqPut(header, 0x12345678, 4); // unique id
+    fseqPut(header, 0, 4);
+    for (auto &b : blocks) {
+      fseqPut(header, b.first, 4);
+      fseqPut(header, b.second, 4);
+    }
+    if (spec.zlib)
+      fseqPut(header, 0, 8);
+    for (auto &r : spec.sparse) {
+      fseqPut(header, r.first, 3);
+      fseqPut(header, r.second, 3);
+    }
+  }
+  header.resize(dataOffset, 0);
+
+  FILE *f = fopen(hostPath.c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(header.data(), 1, header.size(), f) == header.size() &&
+            fwrite(data.data(), 1, data.size(), f) == data.size();
+  fclose(f);
+  return ok;
+}
+
+#endif // FSEQ_FILES_H
@@ -0,0 +1,5 @@
+// The usermod sources under test, built against the stand-ins in stubs/
+#include "../../usermods/FSEQ/fseq_decompressor.cpp"
+#include "../../usermods/FSEQ/fseq_index.cpp"
+#include "../../usermods/FSEQ/fseq_player.cpp"
+#include "../../usermods/FSEQ/fseq_source.cpp"
@@ -0,0 +1,84 @@
+// Definitions behind the host stand-ins in stubs/wled.h
+#include "wled.h"
+
+uint32_t hostMillis = 0;
+HostFS SD;
+HostFS WLED_FS;
+WS2812FX strip;
+HostWiFi WiFi;
+byte realtimeMode = REALTIME_MODE_INACTIVE;
+byte realtimeOverride = REALTIME_OVERRIDE_NONE;
+bool useMainSegmentOnly = false;
+bool gammaCorrectCol = false;
+bool arlsDisableGammaCorrection = true;
+bool psramSafe = true;
+uint32_t hostPixels[HOST_MAX_LEDS];
+uint32_t hostPixelWrites = 0;
+uint32_t File::seeks = 0;
+
+uint32_t millis() { return hostMillis; }
+
+// advances a little on every call, so time budgets measured in
+// microseconds run out even while the test holds the clock
+uint32_t micros() {
+  static uint32_t ticks = 0;
+  return hostMillis * 1000 + (ticks += 100);
+}
+
+File HostFS::open(const char *path, const char *mode) {
+  std::string host = hostPath(path);
+  const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  File file;
+  file.fileName = name;
+  file.hostPath = host;
+  struct stat st;
+  if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    file.dir = opendir(host.c_str());
+    return file;
+  }
+  // binary modes, the player reads and writes raw frame data
+  std::string m = std::string(mode) + "b";
+  file.f = fopen(host.c_str(), m.c_str());
+  return file;
+}
+
+File File::openNextFile() {
+  struct dirent *e;
+  while (dir && (e = readdir(dir))) {
+    if (e->d_name[0] == '.')
+      continue;
+    std::string host = hostPath + "/" + e->d_name;
+    struct stat st;
+    if (stat(host.c_str(), &st) != 0)
+      continue;
+    File file;
+    file.fileName = e->d_name;
+    file.hostPath = host;
+    if (S_ISDIR(st.st_mode))
+      file.dir = opendir(host.c_str());
+    else
+      file.f = fopen(host.c_str(), "rb");
+    return file;
+  }
+  return File();
+}
+
+void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w) {
+  if (i < HOST_MAX_LEDS)
+    hostPixels[i] = RGBW32(r, g, b, w);
+  hostPixelWrites++;
+}
+
+void setRealtimePixels(uint16_t i, const uint8_t *data, unsigned count,
+                       bool rgbw) {
+  const unsigned stride = 3 + rgbw;
+  for (unsigned n = 0; n < count; n++, data += stride)
+    setRealtimePixel(i + n, data[0], data[1], data[2], rgbw ? data[3] : 0);
+}
+
+// entering realtime mode clears the LEDs like the firmware does
+void realtimeLock(uint32_t, byte md) {
+  if (!realtimeMode && !realtimeOverride)
+    memset(hostPixels, 0, sizeof(hostPixels));
+  realtimeMode = md;
+}
@@ -0,0 +1,2 @@
+// host build: the Arduino API is provided by wled.h
+#include "wled.h"
@@ -0,0 +1,2 @@
+// host build: the SD card is provided by wled.h
+#include "wled.h"
@@ -0,0 +1,2 @@
+// host build: SPIClass is provided by wled.h
+#include "wled.h"
@@ -0,0 +1,63 @@
+// Host stand-in for the tinfl inflate API in the ESP32 ROM, backed by zlib.
+// Output is written to the caller's 32 KB wrap-around dictionary like tinfl
+// does with TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF not set.
+#ifndef HOST_ROM_MINIZ_H
+#define HOST_ROM_MINIZ_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <zlib.h>
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_PARSE_ZLIB_HEADER 1
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum {
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+#define HOST_TINFL_MAGIC 0x7a6c6962
+
+struct tinfl_decompressor {
+  uint32_t magic; // the z_stream is initialized
+  z_stream zs;
+};
+
+inline void tinfl_init(tinfl_decompressor *r) {
+  // the struct comes from malloc(), reuse the stream once it was set up
+  if (r->magic == HOST_TINFL_MAGIC) {
+    inflateReset(&r->zs);
+    return;
+  }
+  memset(&r->zs, 0, sizeof(r->zs));
+  inflateInit(&r->zs);
+  r->magic = HOST_TINFL_MAGIC;
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor *r,
+                                     const mz_uint8 *in, size_t *inSize,
+                                     mz_uint8 *, mz_uint8 *out,
+                                     size_t *outSize, mz_uint32) {
+  r->zs.next_in = const_cast<Bytef *>(in);
+  r->zs.avail_in = *inSize;
+  r->zs.next_out = out;
+  r->zs.avail_out = *outSize;
+  int rc = inflate(&r->zs, Z_NO_FLUSH);
+  *inSize -= r->zs.avail_in;
+  *outSize -= r->zs.avail_out;
+  if (rc == Z_STREAM_END)
+    return TINFL_STATUS_DONE;
+  if (rc != Z_OK && rc != Z_BUF_ERROR)
+    return TINFL_STATUS_FAILED;
+  return r->zs.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT
+                              : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif // HOST_ROM_MINIZ_H
@@ -0,0 +1,348 @@
+// Host stand-in for the parts of wled.h used by the FSEQ usermod, so the
+// player can be built and run by the native test environment. The SD card
+// and LittleFS are mapped to a directory on the host, the clock is driven by
+// the tests and LED writes land in hostPixels.
+#ifndef WLED_H
+#define WLED_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+using std::max;
+using std::min;
+
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 0
+#define ARDUINOJSON_ENABLE_STD_STRING 1
+#define ARDUINOJSON_ENABLE_PROGMEM 0
+
+#define PROGMEM
+#define PSTR(x) x
+#define F(x) x
+#define FPSTR(x) (x)
+#define DEBUG_PRINT(...) do {} while (0)
+#define DEBUG_PRINTLN(...) do {} while (0)
+#define DEBUG_PRINTF(...) do {} while (0)
+#define DEBUG_PRINTF_P(...) do {} while (0)
+#define constrain(amt, low, high)                                              \
+  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+// Arduino String on top of std::string
+class String : public std::string {
+public:
+  String() {}
+  String(const char *s) : std::string(s ? s : "") {}
+  String(const std::string &s) : std::string(s) {}
+  String(int v) : std::string(std::to_string(v)) {}
+  String(unsigned v) : std::string(std::to_string(v)) {}
+  String(long v) : std::string(std::to_string(v)) {}
+  String(unsigned long v) : std::string(std::to_string(v)) {}
+  String(float v, int decimals = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    assign(buf);
+  }
+  unsigned length() const { return size(); }
+  bool startsWith(const String &s) const { return rfind(s, 0) == 0; }
+  bool endsWith(const String &s) const {
+    return size() >= s.size() && compare(size() - s.size(), s.size(), s) == 0;
+  }
+  bool equalsIgnoreCase(const String &s) const {
+    return strcasecmp(c_str(), s.c_str()) == 0;
+  }
+  String substring(size_t from) const { return substr(from); }
+  String substring(size_t from, size_t to) const {
+    return substr(from, to - from);
+  }
+  int indexOf(char c, size_t from = 0) const {
+    size_t pos = find(c, from);
+    return pos == npos ? -1 : int(pos);
+  }
+  int lastIndexOf(char c) const {
+    size_t pos = rfind(c);
+    return pos == npos ? -1 : int(pos);
+  }
+  void toLowerCase() {
+    for (char &c : *this)
+      c = tolower(c);
+  }
+  void toUpperCase() {
+    for (char &c : *this)
+      c = toupper(c);
+  }
+  void trim() {
+    size_t first = find_first_not_of(" \t\r\n");
+    size_t last = find_last_not_of(" \t\r\n");
+    *this = first == npos ? String() : String(substr(first, last - first + 1));
+  }
+  void replace(const String &from, const String &to) {
+    for (size_t pos = 0; (pos = find(from, pos)) != npos; pos += to.size())
+      std::string::replace(pos, from.size(), to);
+  }
+  long toInt() const { return atol(c_str()); }
+  float toFloat() const { return atof(c_str()); }
+};
+
+inline String operator+(const String &a, const String &b) {
+  return String(static_cast<const std::string &>(a) +
+                static_cast<const std::string &>(b));
+}
+inline String operator+(const String &a, const char *b) {
+  return String(static_cast<const std::string &>(a) + b);
+}
+inline String operator+(const char *a, const String &b) {
+  return String(a + static_cast<const std::string &>(b));
+}
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t len) {
+    size_t n = 0;
+    while (len--)
+      n += write(*buf++);
+    return n;
+  }
+};
+
+// clock of the host build, set by the tests
+extern uint32_t hostMillis;
+uint32_t millis();
+uint32_t micros();
+inline void yield() {}
+inline void delay(uint32_t ms) { hostMillis += ms; }
+inline uint32_t hw_random() { return rand(); }
+inline uint32_t hw_random(uint32_t upperlimit) { return rand() % upperlimit; }
+
+// file or directory on the host
+class File : public Print {
+public:
+  explicit operator bool() const { return f || dir; }
+  size_t read(uint8_t *buf, size_t len) { return f ? fread(buf, 1, len, f) : 0; }
+  int read() { return f ? fgetc(f) : -1; }
+  size_t write(uint8_t c) override { return f ? fwrite(&c, 1, 1, f) : 0; }
+  size_t write(const uint8_t *buf, size_t len) override {
+    return f ? fwrite(buf, 1, len, f) : 0;
+  }
+  bool seek(uint32_t pos) {
+    seeks++;
+    return f && fseek(f, pos, SEEK_SET) == 0;
+  }
+  size_t position() { return f ? ftell(f) : 0; }
+  size_t size() {
+    struct stat st;
+    return f && fstat(fileno(f), &st) == 0 ? st.st_size : 0;
+  }
+  int available() { return size() - position(); }
+  void flush() {
+    if (f)
+      fflush(f);
+  }
+  void close() {
+    if (f)
+      fclose(f);
+    if (dir)
+      closedir(dir);
+    f = nullptr;
+    dir = nullptr;
+  }
+  const char *name() const { return fileName.c_str(); }
+  bool isDirectory() const { return dir != nullptr; }
+  time_t getLastWrite() {
+    struct stat st;
+    return stat(hostPath.c_str(), &st) == 0 ? st.st_mtime : 0;
+  }
+  File openNextFile();
+
+  // seeks issued on any file, lets tests bound the work of a seek
+  static uint32_t seeks;
+
+private:
+  friend class HostFS;
+  FILE *f = nullptr;
+  DIR *dir = nullptr;
+  std::string fileName;
+  std::string hostPath;
+};
+
+#define CARD_NONE 0
+#define CARD_SD 2
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+// SD card or LittleFS, paths are relative to a host directory
+class HostFS {
+public:
+  std::string root;
+  uint8_t card = CARD_SD; // CARD_NONE hides the card
+
+  uint8_t cardType() const { return card; }
+  bool begin() { return true; }
+  template <typename... Args> bool begin(Args...) { return true; }
+  void end() {}
+  bool exists(const char *path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+  }
+  File open(const char *path, const char *mode = FILE_READ);
+  bool remove(const char *path) { return ::remove(hostPath(path).c_str()) == 0; }
+  bool rename(const char *from, const char *to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+  }
+
+private:
+  std::string hostPath(const char *path) const {
+    return root + (path[0] == '/' ? "" : "/") + path;
+  }
+};
+
+extern HostFS SD;
+extern HostFS WLED_FS;
+#define WLED_USE_SD_SPI
+
+struct SPIClass {
+  SPIClass(int) {}
+  void begin(int, int, int, int) {}
+};
+#define SPI 0
+#define SCK 18
+#define MISO 19
+#define MOSI 23
+#define SS 5
+
+extern bool psramSafe;
+inline bool psramFound() { return true; }
+inline void *ps_malloc(size_t size) { return malloc(size); }
+
+#define RGBW32(r, g, b, w)                                                     \
+  ((uint32_t(w) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) |          \
+   uint32_t(b))
+
+// 1D segment with the pixel buffer the compositor shows
+struct Segment {
+  uint16_t start;
+  uint16_t stop;
+  bool freeze = false;
+  uint32_t *pixels = nullptr;
+  std::vector<uint32_t> buffer;
+
+  Segment(uint16_t start = 0, uint16_t stop = 0) : start(start), stop(stop) {}
+
+  bool is2D() const { return false; }
+  unsigned virtualLength() const { return stop > start ? stop - start : 0; }
+  unsigned virtualWidth() const { return virtualLength(); }
+  unsigned virtualHeight() const { return 1; }
+  bool allocatePixels() {
+    buffer.resize(virtualLength());
+    pixels = buffer.empty() ? nullptr : buffer.data();
+    return pixels;
+  }
+};
+
+#define HOST_MAX_LEDS 4096
+#define HOST_MAX_SEGMENTS 4
+
+class WS2812FX {
+public:
+  uint16_t length = 0;
+  Segment segments[HOST_MAX_SEGMENTS];
+  uint8_t segmentCount = 1;
+  uint32_t shows = 0;
+  uint16_t frameTime = 42; // ms, the default of 24 FPS
+
+  uint32_t triggers = 0;
+
+  void show() { shows++; }
+  void trigger() { triggers++; }
+  uint16_t getFrameTime() const { return frameTime; }
+  uint16_t getLengthTotal() const { return length; }
+  size_t getSegmentsNum() const { return segmentCount; }
+  Segment &getSegment(int id) {
+    return segments[id >= 0 && id < segmentCount ? id : 0];
+  }
+};
+extern WS2812FX strip;
+
+#define REALTIME_MODE_INACTIVE 0
+#define REALTIME_OVERRIDE_NONE 0
+#define REALTIME_OVERRIDE_ONCE 1
+extern byte realtimeMode;
+extern byte realtimeOverride;
+
+extern bool useMainSegmentOnly;
+extern bool gammaCorrectCol;
+extern bool arlsDisableGammaCorrection;
+inline uint32_t gamma32(uint32_t c) { return c; }
+
+// LED colors written through the realtime functions, as RGBW32
+extern uint32_t hostPixels[HOST_MAX_LEDS];
+extern uint32_t hostPixelWrites;
+void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w);
+void setRealtimePixels(uint16_t i, const uint8_t *data, unsigned count,
+                       bool rgbw = false);
+void realtimeLock(uint32_t timeoutMs, byte md);
+
+#include "ArduinoJson-v6.h"
+
+namespace ARDUINOJSON_NAMESPACE {
+template <> struct Converter<::String> {
+  static bool toJson(const ::String &s, VariantRef v) {
+    return v.set(static_cast<const std::string &>(s));
+  }
+  static ::String fromJson(VariantConstRef v) {
+    return ::String(v.as<const char *>());
+  }
+  static bool checkJson(VariantConstRef v) { return v.is<const char *>(); }
+};
+} // namespace ARDUINOJSON_NAMESPACE
+
+#define USERMOD_ID_SD_CARD 37
+
+class Usermod {
+public:
+  virtual ~Usermod() {}
+  virtual void setup() = 0;
+  virtual void loop() = 0;
+  virtual uint16_t getId() { return 0; }
+  virtual void addToJsonInfo(JsonObject &) {}
+  virtual void addToConfig(JsonObject &) {}
+  virtual bool readFromConfig(JsonObject &) { return true; }
+  virtual void onRealtimePixels(unsigned, const uint8_t *, unsigned, bool) {}
+  virtual void onRealtimeShow() {}
+};
+
+struct IPAddress {
+  String toString() const { return String("127.0.0.1"); }
+};
+struct HostWiFi {
+  IPAddress localIP() const { return IPAddress(); }
+};
+extern HostWiFi WiFi;
+
+enum class PinOwner : uint8_t { UM_SdCard };
+struct PinManagerPinType {
+  int8_t pin;
+  bool isOutput;
+};
+struct PinManager {
+  static void deallocatePin(int8_t, PinOwner) {}
+  static bool allocateMultiplePins(PinManagerPinType *, uint8_t, PinOwner) {
+    return true;
+  }
+};
+
+class AsyncWebServerRequest;
+
+#endif // WLED_H
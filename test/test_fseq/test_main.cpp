@@ -0,0 +1,397 @@
+// Host tests and benchmarks for the FSEQ player: pio test -e native
+//
+// Sequences are generated into a temporary directory that stands in for the
+// SD card. The clock only moves when a test advances it, so playback is
+// deterministic; the benchmarks measure wall time around it.
+#include "fseq_files.h"
+#include "wled.h"
+#include "../../usermods/FSEQ/fseq_index.h"
+#include "../../usermods/FSEQ/fseq_player.h"
+#include <chrono>
+#include <filesystem>
+#include <unity.h>
+#include <utime.h>
+
+// lower bounds for the benchmarks, low enough for slow CI machines
+#ifndef FSEQ_BENCH_MIN_FPS
+#define FSEQ_BENCH_MIN_FPS 5000
+#endif
+#ifndef FSEQ_BENCH_MIN_PIXELS_PER_S
+#define FSEQ_BENCH_MIN_PIXELS_PER_S 10000000
+#endif
+
+static std::string testDir;
+
+static void writeSequence(const char *name, const FSEQFileSpec &spec) {
+  TEST_ASSERT_TRUE_MESSAGE(writeFSEQFile(testDir + "/" + name, spec), name);
+}
+
+static uint32_t expectedColor(uint32_t frame, uint32_t channel) {
+  return RGBW32(fseqChannelValue(frame, channel),
+                fseqChannelValue(frame, channel + 1),
+                fseqChannelValue(frame, channel + 2), 0);
+}
+
+// advance the clock in 1 ms steps, running the player like the main loop
+static void runFor(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    hostMillis++;
+    FSEQPlayer::handlePlayers();
+  }
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+static void report(const char *fmt, ...) {
+  char msg[160];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, args);
+  va_end(args);
+  TEST_MESSAGE(msg);
+}
+
+void setUp() {
+  strip.length = 100;
+  strip.segmentCount = 1;
+  strip.segments[0] = {0, 100};
+  SD.card = CARD_SD;
+  memset(hostPixels, 0, sizeof(hostPixels));
+  hostPixelWrites = 0;
+  FSEQPlayer::setChannelWindow(0, 0);
+  FSEQPlayer::setChannelLayout("RGB");
+  FSEQPlayer::setPreloadLimit(0);
+  FSEQPlayer::setInterpolation(false);
+  strip.frameTime = 42;
+}
+
+void tearDown() { FSEQPlayer::primary().stop(); }
+
+// every frame is shown at its time on all LEDs, playback stops after the
+// last one
+static void playsEveryFrame(const char *name, uint32_t channelOfLed0) {
+  FSEQPlayer &player = FSEQPlayer::primary();
+  player.loadRecording(name, 0, 100, 0.0f);
+  TEST_ASSERT_TRUE(player.isPlaying());
+  for (uint32_t f = 0; f < 100; f++) {
+    TEST_ASSERT_EQUAL_HEX32(expectedColor(f, channelOfLed0), hostPixels[0]);
+    TEST_ASSERT_EQUAL_HEX32(expectedColor(f, channelOfLed0 + 297),
+                            hostPixels[99]);
+    runFor(25);
+  }
+  runFor(100);
+  TEST_ASSERT_FALSE(player.isPlaying());
+  TEST_ASSERT_EQUAL_UINT32(100, player.getFramesPlayed());
+  TEST_ASSERT_EQUAL_UINT32(0, player.getFramesDropped());
+}
+
+static void test_v1_uncompressed() {
+  FSEQFileSpec spec;
+  spec.version = 1;
+  writeSequence("v1.fseq", spec);
+  playsEveryFrame("/v1.fseq", 0);
+}
+
+static void test_v2_uncompressed() {
+  writeSequence("v2.fseq", FSEQFileSpec());
+  playsEveryFrame("/v2.fseq", 0);
+}
+
+static void test_v2_zlib() {
+  FSEQFileSpec spec;
+  spec.zlib = true;
+  spec.framesPerBlock = 7; // frames of the last block run short
+  writeSequence("zlib.fseq", spec);
+  playsEveryFrame("/zlib.fseq", 0);
+}
+
+static void test_v2_sparse() {
+  // 30 stored channels for channels 30-44 and 90-104 (LEDs 10-14, 30-34)
+  FSEQFileSpec spec;
+  spec.channels = 30;
+  spec.sparse = {{30, 15}, {90, 15}};
+  writeSequence("sparse.fseq", spec);
+  FSEQPlayer &player = FSEQPlayer::primary();
+  player.loadRecording("/sparse.fseq", 0, 100, 0.0f);
+  runFor(25 * 10);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(10, 0), hostPixels[10]);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(10, 12), hostPixels[14]);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(10, 15), hostPixels[30]);
+  TEST_ASSERT_EQUAL_HEX32(0, hostPixels[20]);
+}
+
+static void test_channel_window() {
+  FSEQFileSpec spec;
+  spec.zlib = true;
+  writeSequence("window.fseq", spec);
+  FSEQPlayer::setChannelWindow(30, 60);
+  FSEQPlayer::primary().loadRecording("/window.fseq", 0, 100, 0.0f);
+  runFor(25 * 3);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(3, 30), hostPixels[0]);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(3, 87), hostPixels[19]);
+  TEST_ASSERT_EQUAL_HEX32(0, hostPixels[20]);
+}
+
+// a segment player fills the frozen segment's buffer for the compositor,
+// the LEDs and realtime mode are left alone
+static void test_segment_player() {
+  writeSequence("segment.fseq", FSEQFileSpec());
+  strip.segmentCount = 2;
+  strip.segments[1] = {20, 40};
+  FSEQPlayer *player =
+      FSEQPlayer::playOnSegment(1, "/segment.fseq", RECORDING_REPEAT_DEFAULT, 30);
+  TEST_ASSERT_TRUE(player != nullptr);
+  const Segment &seg = strip.segments[1];
+  TEST_ASSERT_TRUE(seg.freeze);
+  runFor(25 * 3);
+  TEST_ASSERT_EQUAL_UINT32(REALTIME_MODE_INACTIVE, realtimeMode);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(3, 30), seg.pixels[0]);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(3, 87), seg.pixels[19]);
+  TEST_ASSERT_EQUAL_UINT32(0, hostPixelWrites);
+  player->stop();
+  TEST_ASSERT_FALSE(seg.freeze);
+  TEST_ASSERT_EQUAL_HEX32(0, seg.pixels[0]);
+  TEST_ASSERT_FALSE(player->isPlaying());
+}
+
+static void test_preload() {
+  FSEQFileSpec spec;
+  spec.zlib = true;
+  writeSequence("preload.fseq", spec);
+  FSEQPlayer::setPreloadLimit(1 << 20);
+  FSEQPlayer &player = FSEQPlayer::primary();
+  player.loadRecording("/preload.fseq", 0, 100, 0.0f);
+  TEST_ASSERT_EQUAL_STRING("psram", player.getStorageName());
+  runFor(25 * 50);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(50, 0), hostPixels[0]);
+}
+
+// a 10 fps sequence on a 50 fps strip fades between its frames, and still
+// shows every frame exactly at its time
+static void test_interpolation() {
+  FSEQFileSpec spec;
+  spec.stepTime = 100;
+  writeSequence("slow.fseq", spec);
+  FSEQPlayer::setInterpolation(true);
+  strip.frameTime = 20;
+  FSEQPlayer &player = FSEQPlayer::primary();
+  player.loadRecording("/slow.fseq", 0, 100, 0.0f);
+  runFor(1000);
+  // blue of LED 81 is channel 245: 255 in frame 10, 0 in frame 11
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(10, 243), hostPixels[81]);
+  uint8_t last = 255;
+  for (uint32_t ms = 1; ms < 100; ms++) {
+    runFor(1);
+    uint8_t blue = hostPixels[81];
+    TEST_ASSERT_LESS_OR_EQUAL_UINT8(last, blue);
+    if (ms == 50) {
+      TEST_ASSERT_GREATER_THAN_UINT8(64, blue);
+      TEST_ASSERT_LESS_THAN_UINT8(192, blue);
+    }
+    last = blue;
+  }
+  runFor(1);
+  TEST_ASSERT_EQUAL_HEX32(expectedColor(11, 243), hostPixels[81]);
+  TEST_ASSERT_EQUAL_UINT32(12, player.getFramesPlayed());
+  // four crossfades per frame, from 20 ms after each frame was shown
+  TEST_ASSERT_EQUAL_UINT32(44, player.getFramesBlended());
+}
+
+// frame shown at LED 0 compared to the master's frame, in frames
+static int frameError(float masterSeconds, uint32_t frameCount) {
+  int shown = hostPixels[0] >> 16; // red of LED 0 is the frame number
+  int want = (uint32_t(masterSeconds * 1000) / 25) % frameCount & 0xff;
+  return abs(((shown - want + 128) & 0xff) - 128);
+}
+
+// a master clock running 0.2% fast is followed by slewing, without jumps
+static void test_sync_convergence() {
+  FSEQFileSpec spec;
+  spec.channels = 30;
+  spec.frames = 12000; // 5 minutes at 40 fps
+  writeSequence("long.fseq", spec);
+  FSEQPlayer &player = FSEQPlayer::primary();
+  uint32_t t0 = hostMillis;
+  player.loadRecording("/long.fseq", 0, 10, 0.0f);
+  int maxError = 0;
+  for (uint32_t ms = 1; ms <= 120000; ms++) {
+    hostMillis++;
+    FSEQPlayer::handlePlayers();
+    float master = (hostMillis - t0) * 1.002f / 1000.0f;
+    if (ms % 500 == 0)
+      player.syncPlayback(master);
+    if (ms > 10000 && ms % 97 == 0)
+      maxError = max(maxError, frameError(master - 0.025f, spec.frames));
+  }
+  report("sync: drift %d ms, max error %d frames, jitter %.2f ms",
+         player.getSyncDrift(), maxError, player.getFrameJitter());
+  TEST_ASSERT_LESS_OR_EQUAL_INT(1, maxError);
+  TEST_ASSERT_LESS_OR_EQUAL_INT(25, abs(player.getSyncDrift()));
+  TEST_ASSERT_EQUAL_UINT32(0, player.getSyncJumps());
+}
+
+// large corrections jump, forwards and backwards, in compressed data too
+static void test_sync_jump() {
+  const bool compressed[] = {false, true};
+  for (bool zlib : compressed) {
+    FSEQFileSpec spec;
+    spec.channels = 300;
+    spec.frames = 4000;
+    spec.zlib = zlib;
+    spec.framesPerBlock = 400;
+    writeSequence("jump.fseq", spec);
+    FSEQPlayer &player = FSEQPlayer::primary();
+    player.loadRecording("/jump.fseq", 0, 100, 0.0f);
+    runFor(1000);
+    const float targets[] = {80.0f, 12.3f, 95.0f};
+    for (float target : targets) {
+      uint32_t base = hostMillis - uint32_t(target * 1000);
+      player.syncPlayback(target);
+      runFor(100);
+      TEST_ASSERT_LESS_OR_EQUAL_INT(
+          1, frameError((hostMillis - base - 25) / 1000.0f, spec.frames));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, player.getSyncJumps());
+    report("seek (%s): %u seeks, max %u ms", zlib ? "zlib" : "raw",
+           player.getSeekCount(), player.getMaxSeekMs());
+  }
+}
+
+// run a pending index scan to the end, like the main loop would
+static void scanIndex() {
+  hostMillis += FSEQ_INDEX_SCAN_DELAY_MS;
+  do
+    FSEQIndex::handle();
+  while (FSEQIndex::isScanning());
+}
+
+// write a sequence with the default time of a card written without a clock
+static void writeUnclockedSequence(const char *name, const FSEQFileSpec &spec) {
+  writeSequence(name, spec);
+  struct utimbuf times = {315532800, 315532800}; // 1980-01-01
+  TEST_ASSERT_TRUE(0 == utime((testDir + "/" + name).c_str(), &times));
+}
+
+// a sequence replaced by one of the same size and time must not be started
+// with the indexed header of the old one
+static void test_index_replaced_file() {
+  FSEQFileSpec spec;
+  spec.channels = 300;
+  spec.frames = 200;
+  writeUnclockedSequence("same.fseq", spec);
+  FSEQIndex::begin();
+  TEST_ASSERT_EQUAL_UINT32(0, FSEQIndex::getCount()); // no scan in begin()
+  scanIndex();
+  FSEQIndex::Entry e;
+  TEST_ASSERT_TRUE(FSEQIndex::find("/same.fseq", e));
+  TEST_ASSERT_EQUAL_UINT32(300, e.info.channelCount);
+
+  spec.channels = 600;
+  spec.frames = 100;
+  writeUnclockedSequence("same.fseq", spec);
+  File f = SD.open("/same.fseq");
+  FSEQIndex::Info info;
+  TEST_ASSERT_FALSE(FSEQIndex::lookup("/same.fseq", f, info));
+  TEST_ASSERT_EQUAL_UINT32(0, f.position());
+  f.close();
+
+  FSEQIndex::invalidate();
+  scanIndex();
+  TEST_ASSERT_TRUE(FSEQIndex::find("/same.fseq", e));
+  TEST_ASSERT_EQUAL_UINT32(600, e.info.channelCount);
+  f = SD.open("/same.fseq");
+  TEST_ASSERT_TRUE(FSEQIndex::lookup("/same.fseq", f, info));
+  TEST_ASSERT_EQUAL_UINT32(100, info.frameCount);
+  f.close();
+}
+
+// time to open a sequence: header, block index and the first frames
+static void bench_open() {
+  FSEQFileSpec spec;
+  spec.channels = 1500;
+  spec.frames = 2000;
+  spec.zlib = true;
+  spec.framesPerBlock = 10;
+  writeSequence("open.fseq", spec);
+  FSEQPlayer &player = FSEQPlayer::primary();
+  const int runs = 100;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++)
+    player.loadRecording("/open.fseq", 0, 500, 0.0f);
+  double us = secondsSince(start) * 1e6 / runs;
+  report("open: %.1f us (200 compression blocks)", us);
+  TEST_ASSERT_TRUE(player.isPlaying());
+}
+
+// frames per second read, decompressed and written to the LEDs
+static double playbackRate(const char *name, uint32_t frames,
+                           uint32_t leds) {
+  FSEQPlayer &player = FSEQPlayer::primary();
+  strip.length = leds;
+  player.loadRecording(name, 0, leds, 0.0f);
+  auto start = std::chrono::steady_clock::now();
+  while (player.isPlaying()) {
+    hostMillis += 25; // every call has a frame due
+    FSEQPlayer::handlePlayers();
+  }
+  double fps = player.getFramesPlayed() / secondsSince(start);
+  TEST_ASSERT_EQUAL_UINT32(frames, player.getFramesPlayed());
+  TEST_ASSERT_EQUAL_UINT32(0, player.getFramesDropped());
+  return fps;
+}
+
+static void bench_decode() {
+  FSEQFileSpec spec;
+  spec.channels = 4500; // 1500 RGB pixels
+  spec.frames = 1000;
+  writeSequence("raw1500.fseq", spec);
+  spec.zlib = true;
+  spec.framesPerBlock = 20;
+  writeSequence("zlib1500.fseq", spec);
+
+  double raw = playbackRate("/raw1500.fseq", spec.frames, 1500);
+  double zlib = playbackRate("/zlib1500.fseq", spec.frames, 1500);
+  report("decode: raw %.0f fps, zlib %.0f fps (1500 pixels)", raw, zlib);
+  TEST_ASSERT_GREATER_OR_EQUAL(FSEQ_BENCH_MIN_FPS, raw);
+  TEST_ASSERT_GREATER_OR_EQUAL(FSEQ_BENCH_MIN_FPS, zlib);
+
+  // plain RGB goes to the LEDs in bulk, other orders are unpacked first
+  double direct = raw * 1500;
+  FSEQPlayer::setChannelLayout("GRB");
+  double unpacked = playbackRate("/raw1500.fseq", spec.frames, 1500) * 1500;
+  report("pixels: RGB %.2f M/s, GRB %.2f M/s", direct / 1e6, unpacked / 1e6);
+  TEST_ASSERT_GREATER_OR_EQUAL(FSEQ_BENCH_MIN_PIXELS_PER_S, direct);
+  TEST_ASSERT_GREATER_OR_EQUAL(FSEQ_BENCH_MIN_PIXELS_PER_S, unpacked);
+}
+
+int main() {
+  char dir[] = "/tmp/wled_fseq_XXXXXX";
+  if (!mkdtemp(dir))
+    return 1;
+  testDir = dir;
+  SD.root = testDir;
+  WLED_FS.root = testDir;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_v1_uncompressed);
+  RUN_TEST(test_v2_uncompressed);
+  RUN_TEST(test_v2_zlib);
+  RUN_TEST(test_v2_sparse);
+  RUN_TEST(test_channel_window);
+  RUN_TEST(test_segment_player);
+  RUN_TEST(test_preload);
+  RUN_TEST(test_interpolation);
+  RUN_TEST(test_sync_convergence);
+  RUN_TEST(test_sync_jump);
+  RUN_TEST(test_index_replaced_file);
+  RUN_TEST(bench_open);
+  RUN_TEST(bench_decode);
+  int failures = UNITY_END();
+
+  std::filesystem::remove_all(testDir);
+  return failures;
+}
@@ -0,0 +1,187 @@
+#include "fseq_decompressor.h"
+
+bool FSEQDecompressor::begin(FSEQSource *file,
+                             const FSEQCompressionBlock *blocks,
+                             uint16_t blockCount, uint32_t frameSize) {
+  end();
+  this->file = file;
+  this->blocks = blocks;
+  this->blockCount = blockCount;
+  this->frameSize = frameSize;
+  inflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+  dict = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+  inBuf = (uint8_t *)malloc(FSEQ_INFLATE_INPUT_SIZE);
+  if (!inflator || !dict || !inBuf) {
+    DEBUG_PRINTLN("[FSEQ] Not enough memory for decompression buffers");
+    end();
+    return false;
+  }
+  return true;
+}
+
+void FSEQDecompressor::end() {
+  if (inflator)
+    free(inflator);
+  if (dict)
+    free(dict);
+  if (inBuf)
+    free(inBuf);
+  inflator = nullptr;
+  dict = nullptr;
+  inBuf = nullptr;
+  blockOpen = false;
+}
+
+void FSEQDecompressor::swap(FSEQDecompressor &other) {
+  std::swap(file, other.file);
+  std::swap(blocks, other.blocks);
+  std::swap(blockCount, other.blockCount);
+  std::swap(frameSize, other.frameSize);
+  std::swap(inflator, other.inflator);
+  std::swap(dict, other.dict);
+  std::swap(inBuf, other.inBuf);
+  std::swap(curBlock, other.curBlock);
+  std::swap(blockOpen, other.blockOpen);
+  std::swap(blockDone, other.blockDone);
+  std::swap(blockRemaining, other.blockRemaining);
+  std::swap(blockOutput, other.blockOutput);
+  std::swap(inNext, other.inNext);
+  std::swap(inAvail, other.inAvail);
+  std::swap(dictOfs, other.dictOfs);
+  std::swap(pendingOfs, other.pendingOfs);
+  std::swap(pendingLen, other.pendingLen);
+  std::swap(seeking, other.seeking);
+  std::swap(seekOpen, other.seekOpen);
+  std::swap(seekBlock, other.seekBlock);
+  std::swap(seekTarget, other.seekTarget);
+}
+
+bool FSEQDecompressor::openBlock(uint16_t block) {
+  if (!inflator || block >= blockCount)
+    return false;
+  if (!file->seek(blocks[block].offset) &&
+      file->position() != blocks[block].offset) {
+    DEBUG_PRINTF("[FSEQ] Failed to seek to compression block %u\n", block);
+    return false;
+  }
+  tinfl_init(inflator);
+  curBlock = block;
+  blockOpen = true;
+  blockDone = false;
+  blockRemaining = blocks[block].length;
+  blockOutput = 0;
+  inNext = inBuf;
+  inAvail = 0;
+  dictOfs = 0;
+  pendingOfs = 0;
+  pendingLen = 0;
+  return true;
+}
+
+bool FSEQDecompressor::beginSeek(uint32_t frame) {
+  if (blockCount == 0)
+    return false;
+  // blocks are ordered by frame, find the last one starting at or before frame
+  uint16_t lo = 0, hi = blockCount;
+  while (hi - lo > 1) {
+    uint16_t mid = (lo + hi) / 2;
+    if (blocks[mid].frame <= frame)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  seekBlock = lo;
+  seekTarget = (frame - blocks[lo].frame) * frameSize;
+  // only rewind by restarting the block, moving forward just skips data
+  seekOpen = !blockOpen || curBlock != lo || blockOutput > seekTarget;
+  if (seekOpen)
+    blockOpen = false; // the file position leaves the open block
+  seeking = true;
+  return true;
+}
+
+// Either move the file towards the block or inflate and discard up to
+// FSEQ_SEEK_INFLATE_STEP bytes of it.
+FSEQSeekState FSEQDecompressor::seekStep() {
+  if (!seeking)
+    return FSEQ_SEEK_DONE;
+  if (seekOpen) {
+    FSEQSeekState state = file->seekToward(blocks[seekBlock].offset);
+    if (state == FSEQ_SEEK_DONE && !openBlock(seekBlock))
+      state = FSEQ_SEEK_FAILED;
+    seekOpen = state != FSEQ_SEEK_DONE;
+    if (state == FSEQ_SEEK_FAILED)
+      seeking = false;
+    return state == FSEQ_SEEK_DONE ? FSEQ_SEEK_PENDING : state;
+  }
+  uint32_t skip =
+      min(seekTarget - blockOutput, uint32_t(FSEQ_SEEK_INFLATE_STEP));
+  if (read(nullptr, skip) != skip) {
+    seeking = false;
+    return FSEQ_SEEK_FAILED;
+  }
+  if (blockOutput < seekTarget)
+    return FSEQ_SEEK_PENDING;
+  seeking = false;
+  return FSEQ_SEEK_DONE;
+}
+
+void FSEQDecompressor::inflateStep() {
+  if (inAvail == 0 && blockRemaining > 0) {
+    size_t chunk = min(blockRemaining, uint32_t(FSEQ_INFLATE_INPUT_SIZE));
+    size_t got = file->read(inBuf, chunk);
+    if (got == 0) {
+      blockDone = true; // truncated file
+      return;
+    }
+    blockRemaining -= got;
+    inNext = inBuf;
+    inAvail = got;
+  }
+  size_t inBytes = inAvail;
+  size_t outBytes = TINFL_LZ_DICT_SIZE - dictOfs;
+  mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER;
+  if (blockRemaining > 0)
+    flags |= TINFL_FLAG_HAS_MORE_INPUT;
+  tinfl_status status = tinfl_decompress(inflator, inNext, &inBytes, dict,
+                                         dict + dictOfs, &outBytes, flags);
+  inNext += inBytes;
+  inAvail -= inBytes;
+  pendingOfs = dictOfs;
+  pendingLen = outBytes;
+  dictOfs = (dictOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+  if (status <= TINFL_STATUS_DONE) {
+    if (status < TINFL_STATUS_DONE)
+      DEBUG_PRINTF("[FSEQ] Inflate error %d in block %u\n", status, curBlock);
+    blockDone = true;
+  } else if (inBytes == 0 && outBytes == 0) {
+    blockDone = true; // no progress, stream ended without its final marker
+  }
+}
+
+size_t FSEQDecompressor::read(uint8_t *dst, size_t len) {
+  size_t total = 0;
+  while (len > 0 && blockOpen) {
+    if (pendingLen > 0) {
+      uint32_t n = min(uint32_t(len), pendingLen);
+      if (dst) {
+        memcpy(dst, dict + pendingOfs, n);
+        dst += n;
+      }
+      pendingOfs += n;
+      pendingLen -= n;
+      blockOutput += n;
+      total += n;
+      len -= n;
+    } else if (blockDone) {
+      // blocks are stored back to back, continue with the next one
+      if (!openBlock(curBlock + 1)) {
+        blockOpen = false;
+        break;
+      }
+    } else {
+      inflateStep();
+    }
+  }
+  return total;
+}
@@ -0,0 +1,88 @@
+#ifndef FSEQ_DECOMPRESSOR_H
+#define FSEQ_DECOMPRESSOR_H
+
+#include "fseq_source.h"
+#include "wled.h"
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#include "esp32s3/rom/miniz.h"
+#elif defined(CONFIG_IDF_TARGET_ESP32S2)
+#include "esp32s2/rom/miniz.h"
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+#include "esp32c3/rom/miniz.h"
+#else
+#include "esp32/rom/miniz.h"
+#endif
+
+// size of the compressed input chunk read from file per inflate step
+#ifndef FSEQ_INFLATE_INPUT_SIZE
+#define FSEQ_INFLATE_INPUT_SIZE 1024
+#endif
+// decompressed bytes skipped per step while seeking inside a block
+#ifndef FSEQ_SEEK_INFLATE_STEP
+#define FSEQ_SEEK_INFLATE_STEP 4096
+#endif
+
+// FSEQ v2 compression types (low nibble of header byte 20)
+#define FSEQ_COMPRESSION_NONE 0
+#define FSEQ_COMPRESSION_ZSTD 1
+#define FSEQ_COMPRESSION_ZLIB 2
+
+// one entry of the FSEQ v2 compression block index
+struct FSEQCompressionBlock {
+  uint32_t frame;  // first frame stored in the block
+  uint32_t offset; // absolute file offset of the compressed data
+  uint32_t length; // compressed size in bytes
+};
+
+// Streaming decompressor for zlib compressed FSEQ v2 blocks.
+// Uses the inflate implementation in ROM with a 32 KB wrap-around dictionary,
+// so memory use does not depend on block size.
+class FSEQDecompressor {
+public:
+  FSEQDecompressor() {}
+  ~FSEQDecompressor() { end(); }
+
+  bool begin(FSEQSource *file, const FSEQCompressionBlock *blocks,
+             uint16_t blockCount, uint32_t frameSize);
+  void end();
+  // exchange the complete stream state with another decompressor
+  void swap(FSEQDecompressor &other);
+  // start positioning the stream on the first byte of frame, seekStep()
+  // does the work in bounded steps
+  bool beginSeek(uint32_t frame);
+  FSEQSeekState seekStep();
+  // decompress up to len bytes into dst (nullptr discards them)
+  size_t read(uint8_t *dst, size_t len);
+
+private:
+  bool openBlock(uint16_t block);
+  void inflateStep();
+
+  FSEQSource *file = nullptr;
+  const FSEQCompressionBlock *blocks = nullptr;
+  uint16_t blockCount = 0;
+  uint32_t frameSize = 0;
+
+  tinfl_decompressor *inflator = nullptr;
+  uint8_t *dict = nullptr;
+  uint8_t *inBuf = nullptr;
+
+  uint16_t curBlock = 0;
+  bool blockOpen = false;
+  bool blockDone = false;
+  uint32_t blockRemaining = 0; // compressed bytes not yet read from file
+  uint32_t blockOutput = 0;    // decompressed bytes handed out from block
+  const uint8_t *inNext = nullptr;
+  size_t inAvail = 0;
+  uint32_t dictOfs = 0;
+  uint32_t pendingOfs = 0; // decompressed bytes not yet handed out
+  uint32_t pendingLen = 0;
+
+  bool seeking = false;
+  bool seekOpen = false;   // the file still has to reach seekBlock
+  uint16_t seekBlock = 0;
+  uint32_t seekTarget = 0; // decompressed offset of the frame in seekBlock
+};
+
+#endif // FSEQ_DECOMPRESSOR_H
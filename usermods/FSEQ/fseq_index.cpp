@@ -0,0 +1,271 @@
+#include "fseq_index.h"
+#include "usermod_fseq.h"
+
+// index file layout: magic, version, entry count, then per entry the name
+// length, the name and the Info struct
+#define FSEQ_INDEX_MAGIC 0x58515346 // "FSQX"
+#define FSEQ_INDEX_VERSION (0x0100 | sizeof(FSEQIndex::Info))
+
+std::mutex FSEQIndex::entriesLock;
+std::vector<FSEQIndex::Entry> FSEQIndex::entries;
+std::vector<FSEQIndex::Entry> FSEQIndex::scanEntries;
+File FSEQIndex::scanDir;
+bool FSEQIndex::scanning = false;
+bool FSEQIndex::scanChanged = false;
+bool FSEQIndex::dirty = false;
+uint32_t FSEQIndex::dirtySince = 0;
+uint16_t FSEQIndex::scanHint = 0;
+
+void FSEQIndex::begin() {
+  if (load())
+    DEBUG_PRINTF("[FSEQ] Index loaded with %u files\n", entries.size());
+  // verify in the background, the card may have been changed while powered
+  // off; without a stored index listings stay empty until the scan is done
+  dirty = true;
+  dirtySince = millis() - FSEQ_INDEX_SCAN_DELAY_MS;
+}
+
+void FSEQIndex::invalidate() {
+  dirty = true;
+  dirtySince = millis();
+}
+
+bool FSEQIndex::isSequenceName(const String &name) {
+  return name.endsWith(".fseq") || name.endsWith(".FSEQ");
+}
+
+uint16_t FSEQIndex::getCount() {
+  const std::lock_guard<std::mutex> lock(entriesLock);
+  return entries.size();
+}
+
+bool FSEQIndex::getEntry(uint16_t pos, Entry &entry) {
+  const std::lock_guard<std::mutex> lock(entriesLock);
+  if (pos >= entries.size())
+    return false;
+  entry = entries[pos];
+  return true;
+}
+
+bool FSEQIndex::find(const char *path, Entry &entry) {
+  if (*path == '/')
+    path++;
+  const std::lock_guard<std::mutex> lock(entriesLock);
+  for (const Entry &e : entries)
+    if (e.name == path) {
+      entry = e;
+      return true;
+    }
+  return false;
+}
+
+bool FSEQIndex::lookup(const char *path, File &file, Info &info) {
+  Entry e;
+  if (!find(path, e) || !e.info.sequence || !isUnchanged(file, e.info))
+    return false;
+  info = e.info;
+  return true;
+}
+
+// Size and modification time match the indexed ones. If the time was
+// written without a clock the header is read again and compared, the file
+// position is restored to the start.
+bool FSEQIndex::isUnchanged(File &file, const Info &known) {
+  uint32_t mtime = file.getLastWrite();
+  if (known.size != file.size() || known.mtime != mtime)
+    return false;
+  if (mtime >= FSEQ_INDEX_MIN_MTIME)
+    return true;
+  Info now;
+  memset(&now, 0, sizeof(Info));
+  bool sequence = readHeader(file, now);
+  file.seek(0);
+  if (sequence != known.sequence)
+    return false;
+  return !sequence ||
+         (now.dataOffset == known.dataOffset &&
+          now.minorVersion == known.minorVersion &&
+          now.majorVersion == known.majorVersion &&
+          now.headerLength == known.headerLength &&
+          now.channelCount == known.channelCount &&
+          now.frameCount == known.frameCount &&
+          now.stepTime == known.stepTime && now.flags == known.flags &&
+          now.compression == known.compression &&
+          now.blockCount == known.blockCount &&
+          now.sparseCount == known.sparseCount);
+}
+
+bool FSEQIndex::load() {
+  File f = SD_ADAPTER.open(FSEQ_INDEX_FILE, "r");
+  if (!f)
+    return false;
+  uint32_t magic = 0;
+  uint16_t version = 0, count = 0;
+  bool ok = f.read((uint8_t *)&magic, 4) == 4 &&
+            f.read((uint8_t *)&version, 2) == 2 &&
+            f.read((uint8_t *)&count, 2) == 2 && magic == FSEQ_INDEX_MAGIC &&
+            version == FSEQ_INDEX_VERSION && count <= FSEQ_INDEX_MAX_ENTRIES;
+  const std::lock_guard<std::mutex> lock(entriesLock);
+  entries.clear();
+  if (ok)
+    entries.reserve(count);
+  for (uint16_t i = 0; ok && i < count; i++) {
+    Entry e;
+    uint8_t len = 0;
+    char name[256];
+    ok = f.read(&len, 1) == 1 && f.read((uint8_t *)name, len) == len &&
+         f.read((uint8_t *)&e.info, sizeof(Info)) == sizeof(Info);
+    name[len] = '\0';
+    e.name = name;
+    entries.push_back(e);
+  }
+  f.close();
+  if (!ok) {
+    DEBUG_PRINTLN("[FSEQ] Index file invalid, rebuilding");
+    entries.clear();
+  }
+  return ok;
+}
+
+bool FSEQIndex::save() {
+  File f = SD_ADAPTER.open(FSEQ_INDEX_FILE, FILE_WRITE);
+  if (!f) {
+    DEBUG_PRINTLN("[FSEQ] Failed to write index file");
+    return false;
+  }
+  uint32_t magic = FSEQ_INDEX_MAGIC;
+  uint16_t version = FSEQ_INDEX_VERSION;
+  uint16_t count = entries.size();
+  f.write((const uint8_t *)&magic, 4);
+  f.write((const uint8_t *)&version, 2);
+  f.write((const uint8_t *)&count, 2);
+  for (const Entry &e : entries) {
+    uint8_t len = e.name.length();
+    f.write(&len, 1);
+    f.write((const uint8_t *)e.name.c_str(), len);
+    f.write((const uint8_t *)&e.info, sizeof(Info));
+  }
+  f.close();
+  return true;
+}
+
+// Header fields as the player reads them, without the v2 block and sparse
+// range tables which the player still loads itself.
+bool FSEQIndex::readHeader(File &file, Info &info) {
+  uint8_t h[23];
+  memset(h, 0, sizeof(h));
+  if (file.read(h, sizeof(h)) < 20 || h[0] != 'P' || h[1] != 'S' ||
+      h[2] != 'E' || h[3] != 'Q')
+    return false;
+  info.dataOffset = h[4] | (h[5] << 8);
+  info.minorVersion = h[6];
+  info.majorVersion = h[7];
+  info.headerLength = h[8] | (h[9] << 8);
+  info.channelCount = h[10] | (h[11] << 8) | (h[12] << 16) | (h[13] << 24);
+  info.frameCount =
+      h[14] | (h[15] << 8) | (h[16] << 16) | ((uint32_t)h[17] << 24);
+  info.stepTime = h[18];
+  info.flags = h[19];
+  if (info.majorVersion >= 2) {
+    info.compression = h[20] & 0x0F;
+    info.blockCount = h[21] | ((h[20] & 0xF0) << 4);
+    info.sparseCount = h[22];
+  }
+  return true;
+}
+
+void FSEQIndex::startScan() {
+  dirty = false;
+  scanDir = SD_ADAPTER.open("/");
+  if (!scanDir || !scanDir.isDirectory()) {
+    scanDir.close();
+    return;
+  }
+  scanning = true;
+  scanChanged = false;
+  scanHint = 0;
+  scanEntries.clear();
+  scanEntries.reserve(entries.size());
+}
+
+void FSEQIndex::scanFile(File &file) {
+  if (file.isDirectory())
+    return;
+  String name = file.name();
+  if (name.startsWith("/"))
+    name = name.substring(1);
+  if (name == &FSEQ_INDEX_FILE[1])
+    return;
+  if (scanEntries.size() >= FSEQ_INDEX_MAX_ENTRIES) {
+    DEBUG_PRINTF("[FSEQ] Index full, %s not listed\n", name.c_str());
+    return;
+  }
+  // the directory order rarely changes, try the expected position first
+  const Entry *known = nullptr;
+  if (scanHint < entries.size() && entries[scanHint].name == name)
+    known = &entries[scanHint];
+  else
+    for (const Entry &e : entries)
+      if (e.name == name) {
+        known = &e;
+        break;
+      }
+  if (known) {
+    scanHint = (known - &entries[0]) + 1;
+    // only sequence headers are indexed, other files just need to match
+    bool unchanged = isSequenceName(name)
+                         ? isUnchanged(file, known->info)
+                         : known->info.size == file.size() &&
+                               known->info.mtime == file.getLastWrite();
+    if (unchanged) {
+      scanEntries.push_back(*known);
+      return;
+    }
+  }
+
+  Entry e;
+  e.name = name;
+  memset(&e.info, 0, sizeof(Info));
+  if (isSequenceName(name))
+    e.info.sequence = readHeader(file, e.info);
+  e.info.size = file.size();
+  e.info.mtime = file.getLastWrite();
+  scanEntries.push_back(e);
+  scanChanged = true;
+}
+
+void FSEQIndex::finishScan() {
+  scanDir.close();
+  scanning = false;
+  if (scanEntries.size() != entries.size())
+    scanChanged = true;
+  {
+    const std::lock_guard<std::mutex> lock(entriesLock);
+    entries.swap(scanEntries);
+  }
+  scanEntries.clear();
+  scanEntries.shrink_to_fit();
+  if (scanChanged) {
+    DEBUG_PRINTF("[FSEQ] Index updated, %u files\n", entries.size());
+    save();
+  }
+}
+
+void FSEQIndex::handle() {
+  if (!scanning) {
+    if (!dirty || millis() - dirtySince < FSEQ_INDEX_SCAN_DELAY_MS)
+      return;
+    startScan();
+    if (!scanning)
+      return;
+  }
+  for (uint8_t i = 0; i < FSEQ_INDEX_SCAN_BATCH; i++) {
+    File file = scanDir.openNextFile();
+    if (!file) {
+      finishScan();
+      return;
+    }
+    scanFile(file);
+    file.close();
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef FSEQ_INDEX_H
+#define FSEQ_INDEX_H
+
+#include "wled.h"
+#include <mutex>
+#include <vector>
+#ifdef WLED_USE_SD_SPI
+#include <SD.h>
+#include <SPI.h>
+#elif defined(WLED_USE_SD_MMC)
+#include "SD_MMC.h"
+#endif
+
+// index file on the SD card, excluded from the listings
+#ifndef FSEQ_INDEX_FILE
+#define FSEQ_INDEX_FILE "/fseq.idx"
+#endif
+// files examined per loop() call while the index is rebuilt
+#ifndef FSEQ_INDEX_SCAN_BATCH
+#define FSEQ_INDEX_SCAN_BATCH 4
+#endif
+// quiet time after an upload or delete before the card is rescanned
+#ifndef FSEQ_INDEX_SCAN_DELAY_MS
+#define FSEQ_INDEX_SCAN_DELAY_MS 2000
+#endif
+#ifndef FSEQ_INDEX_MAX_ENTRIES
+#define FSEQ_INDEX_MAX_ENTRIES 512
+#endif
+// modification times before this (2021-01-01) were written without a set
+// clock, FAT then stores the same default time for every file
+#ifndef FSEQ_INDEX_MIN_MTIME
+#define FSEQ_INDEX_MIN_MTIME 1609459200
+#endif
+
+// Persistent index of the files in the SD card root with the header data of
+// every FSEQ sequence. Listings are served from memory and playback start
+// takes the header from here instead of parsing it again.
+//
+// The index is loaded from FSEQ_INDEX_FILE at boot and verified (or built,
+// on a new card) by a scan that runs a few files per loop() call. Only files
+// whose size or modification time changed have their header read again.
+// Without a clock the modification time cannot tell a replaced file of the
+// same size, so such files have their header compared instead.
+class FSEQIndex {
+public:
+  // header fields of a sequence, stored as is in the index file
+  struct Info {
+    uint32_t size;
+    uint32_t mtime;
+    uint32_t channelCount;
+    uint32_t frameCount;
+    uint16_t dataOffset;
+    uint16_t headerLength;
+    uint16_t blockCount; // compression blocks as declared in the header
+    uint8_t minorVersion;
+    uint8_t majorVersion;
+    uint8_t stepTime;
+    uint8_t flags;
+    uint8_t compression;
+    uint8_t sparseCount;
+    bool sequence; // valid FSEQ header
+  };
+
+  struct Entry {
+    String name; // without leading '/'
+    Info info;
+    uint32_t durationMs() const {
+      return info.sequence ? info.frameCount * info.stepTime : 0;
+    }
+  };
+
+  // load the stored index and schedule a scan, does not scan itself
+  static void begin();
+  // called from the usermod loop, advances a pending scan
+  static void handle();
+  // files were added or removed, rescan once the card is quiet
+  static void invalidate();
+  static bool isScanning() { return scanning; }
+
+  // entries are copied out, web handlers run in another task than the scan
+  static uint16_t getCount();
+  static bool getEntry(uint16_t pos, Entry &entry);
+  static bool find(const char *path, Entry &entry);
+  // header data for an opened sequence, false if it is not indexed or the
+  // file changed since
+  static bool lookup(const char *path, File &file, Info &info);
+  static bool isSequenceName(const String &name);
+
+private:
+  FSEQIndex() {}
+
+  static bool load();
+  static bool save();
+  static void startScan();
+  static void scanFile(File &file);
+  static void finishScan();
+  static bool readHeader(File &file, Info &info);
+  static bool isUnchanged(File &file, const Info &known);
+
+  static std::mutex entriesLock;
+  static std::vector<Entry> entries;
+  static std::vector<Entry> scanEntries; // result of the running scan
+  static File scanDir;
+  static bool scanning;
+  static bool scanChanged; // scan found differences to the stored index
+  static bool dirty;
+  static uint32_t dirtySince;
+  static uint16_t scanHint; // expected position of the next file in entries
+};
+
+#endif // FSEQ_INDEX_H
@@ -21,59 +21,51 @@ int8_t UsermodFseq::configPinPoci = 19;
 int8_t UsermodFseq::configPinPico = 23;
 #endif
 
-File FSEQPlayer::recordingFile;
-String FSEQPlayer::currentFileName = "";
-float FSEQPlayer::secondsElapsed = 0;
-
-uint8_t FSEQPlayer::colorChannels = 3;
-int32_t FSEQPlayer::recordingRepeats = RECORDING_REPEAT_DEFAULT;
+FSEQPlayer FSEQPlayer::players[FSEQ_MAX_PLAYERS];
 uint32_t FSEQPlayer::now = 0;
-uint32_t FSEQPlayer::next_time = 0;
-uint16_t FSEQPlayer::playbackLedStart = 0;
-uint16_t FSEQPlayer::playbackLedStop = uint16_t(-1);
-uint32_t FSEQPlayer::frame = 0;
-uint16_t FSEQPlayer::buffer_size = 48;
-FSEQPlayer::FileHeader FSEQPlayer::file_header;
+
+uint32_t FSEQPlayer::channelWindowStart = 0;
+uint32_t FSEQPlayer::channelWindowCount = 0;
+String FSEQPlayer::channelLayoutSpec = "RGB";
+FSEQPlayer::ChannelLayout FSEQPlayer::layouts[FSEQ_MAX_PROPS] = {
+    {0, 3, 3, {0, 1, 2}, {0, 1, 2}, false, true}};
+uint8_t FSEQPlayer::layoutCount = 1;
+const FSEQPlayer::ChannelLayout FSEQPlayer::rgbLayout = {
+    0, 3, 3, {0, 1, 2}, {0, 1, 2}, false, true};
+uint32_t FSEQPlayer::preloadLimit = 0;
+bool FSEQPlayer::interpolate = false;
+uint32_t FSEQPlayer::lastShow = 0;
 
 inline uint32_t FSEQPlayer::readUInt32() {
-  char buffer[4];
-  if (recordingFile.readBytes(buffer, 4) < 4)
+  uint8_t buffer[4];
+  if (recordingFile.read(buffer, 4) < 4)
     return 0;
   return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) |
          ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
 }
 
 inline uint32_t FSEQPlayer::readUInt24() {
-  char buffer[3];
-  if (recordingFile.readBytes(buffer, 3) < 3)
+  uint8_t buffer[3];
+  if (recordingFile.read(buffer, 3) < 3)
     return 0;
   return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) |
          ((uint32_t)buffer[2] << 16);
 }
 
 inline uint16_t FSEQPlayer::readUInt16() {
-  char buffer[2];
-  if (recordingFile.readBytes(buffer, 2) < 2)
+  uint8_t buffer[2];
+  if (recordingFile.read(buffer, 2) < 2)
     return 0;
   return (uint16_t)buffer[0] | ((uint16_t)buffer[1] << 8);
 }
 
 inline uint8_t FSEQPlayer::readUInt8() {
-  char buffer[1];
-  if (recordingFile.readBytes(buffer, 1) < 1)
+  uint8_t buffer[1];
+  if (recordingFile.read(buffer, 1) < 1)
     return 0;
   return (uint8_t)buffer[0];
 }
 
-bool FSEQPlayer::fileOnSD(const char *filepath) {
-  uint8_t cardType = SD_ADAPTER.cardType();
-  if (cardType == CARD_NONE)
-    return false;
-  return SD_ADAPTER.exists(filepath);
-}
-
-bool FSEQPlayer::fileOnFS(const char *filepath) { return false; }
-
 void FSEQPlayer::printHeaderInfo() {
   DEBUG_PRINTLN("FSEQ file header:");
   DEBUG_PRINTF(" channel_data_offset = %d\n", file_header.channel_data_offset);
@@ -84,172 +76,1104 @@ void FSEQPlayer::printHeaderInfo() {
   DEBUG_PRINTF(" frame_count         = %d\n", file_header.frame_count);
   DEBUG_PRINTF(" step_time           = %d\n", file_header.step_time);
   DEBUG_PRINTF(" flags               = %d\n", file_header.flags);
+  if (file_header.major_version < 2)
+    return;
+  DEBUG_PRINTF(" compression_type    = %d\n", file_header.compression_type);
+  DEBUG_PRINTF(" compression_blocks  = %d\n",
+               file_header.compression_block_count);
+  DEBUG_PRINTF(" sparse_ranges       = %d\n", file_header.sparse_range_count);
 }
 
-void FSEQPlayer::processFrameData() {
-  uint16_t packetLength = file_header.channel_count;
-  uint16_t lastLed =
-      min(playbackLedStop, uint16_t(playbackLedStart + (packetLength / 3)));
-  char frame_data[buffer_size];
-  CRGB *crgb = reinterpret_cast<CRGB *>(frame_data);
-  uint16_t bytes_remaining = packetLength;
-  uint16_t index = playbackLedStart;
-  while (index < lastLed && bytes_remaining > 0) {
-    uint16_t length = min(bytes_remaining, buffer_size);
-    recordingFile.readBytes(frame_data, length);
-    bytes_remaining -= length;
-    for (uint16_t offset = 0; offset < length / 3; offset++) {
-      setRealtimePixel(index, crgb[offset].r, crgb[offset].g, crgb[offset].b,
-                       0);
-      if (++index > lastLed)
+// Fill file_header from the index when the file is on the SD card and did
+// not change since it was indexed, parse the fixed header and the v2 fields
+// otherwise.
+bool FSEQPlayer::readHeader(const char *filepath) {
+  FSEQIndex::Info info;
+  if (recordingFile.getStorage() == FSEQSource::SD_CARD &&
+      FSEQIndex::lookup(filepath, recordingFile.getFile(), info)) {
+    memcpy(file_header.identifier, "PSEQ", 4);
+    file_header.channel_data_offset = info.dataOffset;
+    file_header.minor_version = info.minorVersion;
+    file_header.major_version = info.majorVersion;
+    file_header.header_length = info.headerLength;
+    file_header.channel_count = info.channelCount;
+    file_header.frame_count = info.frameCount;
+    file_header.step_time = info.stepTime;
+    file_header.flags = info.flags;
+    file_header.compression_type = info.compression;
+    file_header.compression_block_count = info.blockCount;
+    file_header.sparse_range_count = info.sparseCount;
+    return true;
+  }
+  for (int i = 0; i < 4; i++) {
+    file_header.identifier[i] = readUInt8();
+  }
+  file_header.channel_data_offset = readUInt16();
+  file_header.minor_version = readUInt8();
+  file_header.major_version = readUInt8();
+  file_header.header_length = readUInt16();
+  file_header.channel_count = readUInt32();
+  file_header.frame_count = readUInt32();
+  file_header.step_time = readUInt8();
+  file_header.flags = readUInt8();
+  file_header.compression_type = FSEQ_COMPRESSION_NONE;
+  file_header.compression_block_count = 0;
+  file_header.sparse_range_count = 0;
+  if (file_header.identifier[0] != 'P' || file_header.identifier[1] != 'S' ||
+      file_header.identifier[2] != 'E' || file_header.identifier[3] != 'Q') {
+    DEBUG_PRINTF("Error reading FSEQ file %s header, invalid identifier\n",
+                 filepath);
+    return false;
+  }
+  if (file_header.major_version >= 2) {
+    uint8_t b20 = readUInt8();
+    uint8_t b21 = readUInt8();
+    file_header.compression_type = b20 & 0x0F;
+    file_header.compression_block_count = b21 | ((b20 & 0xF0) << 4);
+    file_header.sparse_range_count = readUInt8();
+  }
+  return true;
+}
+
+// Read the v2 block index and sparse ranges. Block offsets are accumulated
+// so seeks go straight to the block.
+bool FSEQPlayer::readHeaderTables() {
+  freeExtendedHeader();
+  if (!recordingFile.seek(FSEQ_V2_HEADER_SIZE)) // skip flags and unique id
+    return false;
+
+  uint16_t maxBlocks = file_header.compression_block_count;
+  if (file_header.compression_type != FSEQ_COMPRESSION_NONE && maxBlocks) {
+    compressionBlocks = (FSEQCompressionBlock *)malloc(
+        maxBlocks * sizeof(FSEQCompressionBlock));
+    if (!compressionBlocks)
+      return false;
+  }
+  uint32_t offset = file_header.channel_data_offset;
+  uint16_t blocks = 0;
+  for (uint16_t i = 0; i < maxBlocks; i++) {
+    uint32_t frame = readUInt32();
+    uint32_t length = readUInt32();
+    // unused trailing entries have zero length
+    if (length == 0 || !compressionBlocks)
+      continue;
+    compressionBlocks[blocks].frame = frame;
+    compressionBlocks[blocks].offset = offset;
+    compressionBlocks[blocks].length = length;
+    offset += length;
+    blocks++;
+  }
+  file_header.compression_block_count = blocks;
+
+  if (file_header.sparse_range_count) {
+    sparseRanges = (SparseRange *)malloc(file_header.sparse_range_count *
+                                         sizeof(SparseRange));
+    if (!sparseRanges)
+      return false;
+    for (uint8_t i = 0; i < file_header.sparse_range_count; i++) {
+      sparseRanges[i].start = readUInt24();
+      sparseRanges[i].count = readUInt24();
+    }
+  }
+  return true;
+}
+
+void FSEQPlayer::freeExtendedHeader() {
+  if (compressionBlocks)
+    free(compressionBlocks);
+  if (sparseRanges)
+    free(sparseRanges);
+  if (pixelRuns)
+    free(pixelRuns);
+  compressionBlocks = nullptr;
+  sparseRanges = nullptr;
+  pixelRuns = nullptr;
+  pixelRunCount = 0;
+  decompressor.end();
+}
+
+void FSEQPlayer::setChannelWindow(uint32_t start, uint32_t count) {
+  channelWindowStart = start;
+  channelWindowCount = count;
+}
+
+// the configured props for the primary player, plain RGB for segments
+const FSEQPlayer::ChannelLayout *FSEQPlayer::getLayouts(uint8_t &count) const {
+  if (segment >= 0) {
+    count = 1;
+    return &rgbLayout;
+  }
+  count = layoutCount;
+  return layouts;
+}
+
+bool FSEQPlayer::setChannelLayout(const String &layout) {
+  String spec = layout;
+  spec.replace(" ", "");
+  spec.toUpperCase();
+  if (spec.length() == 0)
+    spec = "RGB";
+  ChannelLayout parsed[FSEQ_MAX_PROPS];
+  uint8_t count = 0;
+  if (!parseChannelLayout(spec.c_str(), parsed, count)) {
+    DEBUG_PRINTF("[FSEQ] Invalid channel layout %s\n", layout.c_str());
+    return false;
+  }
+  memcpy(layouts, parsed, count * sizeof(ChannelLayout));
+  layoutCount = count;
+  channelLayoutSpec = spec;
+  return true;
+}
+
+// Parse "LETTERS[:pixels][,LETTERS[:pixels]...]" where each letter is one
+// byte of a pixel: R, G, B, W, L (intensity shown as grey) or X (unused).
+bool FSEQPlayer::parseChannelLayout(const char *spec, ChannelLayout *out,
+                                    uint8_t &count) {
+  count = 0;
+  while (*spec) {
+    if (count >= FSEQ_MAX_PROPS)
+      return false;
+    ChannelLayout &l = out[count];
+    memset(&l, 0, sizeof(l));
+    auto copy = [&l](uint8_t channel) {
+      if (l.copies >= sizeof(l.src))
+        return false;
+      l.src[l.copies] = l.bytes;
+      l.dst[l.copies++] = channel;
+      return true;
+    };
+    for (; *spec && *spec != ':' && *spec != ','; spec++) {
+      if (l.bytes >= sizeof(l.src))
+        return false;
+      bool ok = true;
+      switch (*spec) {
+      case 'R':
+        ok = copy(0);
         break;
+      case 'G':
+        ok = copy(1);
+        break;
+      case 'B':
+        ok = copy(2);
+        break;
+      case 'W':
+        ok = copy(3);
+        l.white = true;
+        break;
+      case 'L':
+        ok = copy(0) && copy(1) && copy(2);
+        break;
+      case 'X':
+        break;
+      default:
+        return false;
+      }
+      if (!ok)
+        return false;
+      l.bytes++;
+    }
+    if (l.bytes == 0)
+      return false;
+    if (*spec == ':') {
+      char *end;
+      l.pixels = strtoul(spec + 1, &end, 10);
+      spec = end;
     }
+    // plain RGB/RGBW data can be handed to the buses without conversion
+    l.direct = l.bytes == 3 + l.white && l.copies == l.bytes;
+    for (uint8_t c = 0; c < l.copies && l.direct; c++)
+      l.direct = l.src[c] == c && l.dst[c] == c;
+    count++;
+    if (*spec == ',')
+      spec++;
+    else if (*spec)
+      return false;
   }
-  strip.show();
+  return count > 0;
+}
+
+// Map the channel window (window starts are relative to windowStart, stored
+// back to back in the frame buffer) onto the props of the layout.
+// Returns the number of runs, runs may be nullptr to only count them.
+uint16_t FSEQPlayer::buildPixelRuns(const SparseRange *window, uint8_t count,
+                                    PixelRun *runs) {
+  uint8_t layoutCount;
+  const ChannelLayout *layouts = getLayouts(layoutCount);
+  uint32_t ledCount = playbackLedStop > playbackLedStart
+                          ? playbackLedStop - playbackLedStart
+                          : 0;
+  uint16_t n = 0;
+  uint32_t bufferOffset = 0;
+  for (uint8_t r = 0; r < count; r++) {
+    uint32_t rangeStart = window[r].start;
+    uint32_t rangeEnd = rangeStart + window[r].count;
+    uint32_t channel = 0, led = 0;
+    for (uint8_t p = 0; p < layoutCount && led < ledCount; p++) {
+      const ChannelLayout &l = layouts[p];
+      uint32_t pixels = ledCount - led;
+      if (l.pixels && l.pixels < pixels)
+        pixels = l.pixels;
+      uint32_t propEnd = channel + pixels * l.bytes;
+      uint32_t a = max(rangeStart, channel);
+      uint32_t b = min(rangeEnd, propEnd);
+      // only pixels with all their channels inside the range are shown
+      uint32_t first = a < b ? (a - channel + l.bytes - 1) / l.bytes : 0;
+      uint32_t last = a < b ? (b - channel) / l.bytes : 0;
+      if (first < last) {
+        if (runs) {
+          runs[n].dataOffset =
+              bufferOffset + channel + first * l.bytes - rangeStart;
+          runs[n].led = playbackLedStart + led + first;
+          runs[n].pixels = last - first;
+          runs[n].layout = p;
+        }
+        n++;
+      }
+      channel = propEnd;
+      led += pixels;
+    }
+    bufferOffset += window[r].count;
+  }
+  return n;
+}
+
+// Work out which part of a stored frame is needed for the configured channel
+// window and the LEDs we drive. Sparse ranges are stored back to back in
+// ascending channel order, so the clipped ranges form one contiguous slice.
+bool FSEQPlayer::computeChannelWindow() {
+  // a file without sparse ranges is a single range starting at channel 0
+  SparseRange whole = {0, file_header.channel_count};
+  const SparseRange *ranges = sparseRanges ? sparseRanges : &whole;
+  uint8_t rangeCount = sparseRanges ? file_header.sparse_range_count : 1;
+
+  uint8_t layoutCount;
+  const ChannelLayout *layouts = getLayouts(layoutCount);
+  uint32_t winStart = windowStart;
+  uint32_t winCount = windowCount ? windowCount : UINT32_MAX;
+  // channels past our last LED are never shown, do not read them either
+  uint32_t ledCount = playbackLedStop > playbackLedStart
+                          ? playbackLedStop - playbackLedStart
+                          : 0;
+  uint32_t ledChannels = 0;
+  for (uint8_t p = 0; p < layoutCount && ledCount > 0; p++) {
+    uint32_t pixels = ledCount;
+    if (layouts[p].pixels && layouts[p].pixels < pixels)
+      pixels = layouts[p].pixels;
+    ledChannels += pixels * layouts[p].bytes;
+    ledCount -= pixels;
+  }
+  if (winCount > ledChannels)
+    winCount = ledChannels;
+  uint32_t winEnd = winStart + min(winCount, UINT32_MAX - winStart);
+
+  SparseRange *window =
+      (SparseRange *)malloc(rangeCount * sizeof(SparseRange));
+  if (!window)
+    return false;
+  uint8_t windowCount = 0;
+  windowOffset = 0;
+  frameStride = 0;
+  frameSize = 0;
+  for (uint8_t r = 0; r < rangeCount; r++) {
+    uint32_t first = max(ranges[r].start, winStart);
+    uint32_t last = min(ranges[r].start + ranges[r].count, winEnd);
+    if (first < last) {
+      if (windowCount == 0)
+        windowOffset = frameStride + (first - ranges[r].start);
+      window[windowCount].start = first - winStart;
+      window[windowCount].count = last - first;
+      windowCount++;
+      frameSize = frameStride + (last - ranges[r].start) - windowOffset;
+    }
+    frameStride += ranges[r].count;
+  }
+
+  if (pixelRuns)
+    free(pixelRuns);
+  pixelRunCount = buildPixelRuns(window, windowCount, nullptr);
+  pixelRuns = (PixelRun *)malloc(max(pixelRunCount, uint16_t(1)) *
+                                 sizeof(PixelRun));
+  if (pixelRuns)
+    buildPixelRuns(window, windowCount, pixelRuns);
+  free(window);
+  if (!pixelRuns) {
+    pixelRunCount = 0;
+    return false;
+  }
+  DEBUG_PRINTF("[FSEQ] Reading %u of %u bytes per frame at offset %u, %u "
+               "pixel runs\n",
+               frameSize, frameStride, windowOffset, pixelRunCount);
+  return frameSize > 0;
+}
+
+bool FSEQPlayer::allocatePrefetchRing() {
+  freePrefetchRing();
+  if (frameSize == 0)
+    return false;
+  uint32_t depth = FSEQ_PREFETCH_MAX_BYTES / frameSize;
+  if (depth > FSEQ_PREFETCH_DEPTH)
+    depth = FSEQ_PREFETCH_DEPTH;
+  if (depth < 1)
+    depth = 1; // a single frame is always buffered, even if it is huge
+  // retry with a shallower ring if the heap is fragmented
+  while (depth > 0 && !frameRing) {
+    frameRing = (uint8_t *)malloc(depth * frameSize);
+    if (!frameRing)
+      depth--;
+  }
+  prefetchDepth = depth;
+  DEBUG_PRINTF("[FSEQ] Prefetch ring: %u x %u bytes\n", prefetchDepth,
+               frameSize);
+  // without memory for the crossfade the frames are just held
+  if (frameRing && interpolate)
+    blendBuffer = (uint8_t *)malloc(2 * frameSize);
+  return frameRing != nullptr;
+}
+
+void FSEQPlayer::freePrefetchRing() {
+  if (frameRing)
+    free(frameRing);
+  frameRing = nullptr;
+  if (blendBuffer)
+    free(blendBuffer);
+  blendBuffer = nullptr;
+  blendReady = false;
+  prefetchDepth = 0;
+  ringFill = 0;
+  ringHead = 0;
+}
+
+// drop all buffered frames and continue reading at startFrame
+void FSEQPlayer::resetPrefetch(uint32_t startFrame) {
+  ringHead = 0;
+  ringFill = 0;
+  readFrame = startFrame;
+  readSeek = true;
+  seekPending = false;
+  readDone = false;
+  blendReady = false; // no crossfade across a jump
+}
+
+// Move the read position to readFrame. The seek is done in steps and paused
+// after FSEQ_SEEK_BUDGET_US, so resyncing to a distant point of a long show
+// does not stall the loop; it continues with the next read.
+FSEQSeekState FSEQPlayer::seekReadFrame() {
+  bool compressed = file_header.compression_type != FSEQ_COMPRESSION_NONE;
+  uint32_t offset = file_header.channel_data_offset + frameStride * readFrame;
+  if (!compressed && frameSize < frameStride)
+    offset += windowOffset;
+  if (!seekPending) {
+    if (compressed && !decompressor.beginSeek(readFrame))
+      return FSEQ_SEEK_FAILED;
+    seekPending = true;
+    seekStart = millis();
+  }
+  FSEQSeekState state;
+  uint32_t t0 = micros();
+  do {
+    state = compressed ? decompressor.seekStep()
+                       : recordingFile.seekToward(offset);
+  } while (state == FSEQ_SEEK_PENDING && micros() - t0 < FSEQ_SEEK_BUDGET_US);
+  if (state == FSEQ_SEEK_PENDING)
+    return state;
+  seekPending = false;
+  if (state == FSEQ_SEEK_DONE) {
+    lastSeekMs = millis() - seekStart;
+    if (lastSeekMs > maxSeekMs)
+      maxSeekMs = lastSeekMs;
+    seekCount++;
+  }
+  return state;
+}
+
+// Read up to count consecutive frames starting at readFrame into dst,
+// returns the number of complete frames read.
+uint32_t FSEQPlayer::readFrames(uint8_t *dst, uint32_t count) {
+  bool compressed = file_header.compression_type != FSEQ_COMPRESSION_NONE;
+  if (readSeek) {
+    FSEQSeekState state = seekReadFrame();
+    if (state == FSEQ_SEEK_FAILED)
+      DEBUG_PRINTF("Failed to seek to frame %u!\n", readFrame);
+    if (state != FSEQ_SEEK_DONE)
+      return 0;
+    readSeek = false;
+  }
+  if (frameSize < frameStride && !compressed) {
+    // channel window: one short forward seek and one read of our slice per
+    // frame
+    uint32_t done = 0;
+    for (; done < count; done++, dst += frameSize) {
+      uint32_t offset = file_header.channel_data_offset +
+                        frameStride * (readFrame + done) + windowOffset;
+      if ((!recordingFile.seek(offset) &&
+           recordingFile.position() != offset) ||
+          recordingFile.read(dst, frameSize) != frameSize) {
+        readSeek = true;
+        break;
+      }
+    }
+    return done;
+  }
+  if (frameSize < frameStride) {
+    // compressed data has to be inflated in full, keep only our slice
+    uint32_t tail = frameStride - windowOffset - frameSize;
+    uint32_t done = 0;
+    for (; done < count; done++, dst += frameSize) {
+      if (decompressor.read(nullptr, windowOffset) != windowOffset ||
+          decompressor.read(dst, frameSize) != frameSize ||
+          decompressor.read(nullptr, tail) != tail) {
+        readSeek = true;
+        break;
+      }
+    }
+    return done;
+  }
+  size_t got = compressed ? decompressor.read(dst, count * frameSize)
+                          : recordingFile.read(dst, count * frameSize);
+  if (got % frameSize)
+    readSeek = true; // partial trailing frame, re-read it next time
+  return got / frameSize;
+}
+
+// Top up the ring with consecutive frames. Each pass issues a single
+// sequential read covering as many free, contiguous slots as possible.
+void FSEQPlayer::fillPrefetchRing(uint8_t maxReads) {
+  while (maxReads-- > 0 && frameRing && !readDone &&
+         ringFill < prefetchDepth) {
+    if (readFrame >= file_header.frame_count) {
+      if (recordingRepeats == RECORDING_REPEAT_LOOP) {
+        readFrame = 0;
+      } else if (recordingRepeats > 0) {
+        recordingRepeats--;
+        readFrame = 0;
+        DEBUG_PRINTF("Repeat recording again for: %d\n", recordingRepeats);
+      } else {
+        readDone = true;
+        return;
+      }
+      readSeek = true;
+    }
+    uint8_t tail = (ringHead + ringFill) % prefetchDepth;
+    uint32_t count = prefetchDepth - ringFill;
+    if (count > uint32_t(prefetchDepth - tail))
+      count = prefetchDepth - tail; // do not wrap inside a single read
+    if (count > file_header.frame_count - readFrame)
+      count = file_header.frame_count - readFrame;
+    count = readFrames(frameRing + tail * frameSize, count);
+    if (count == 0 && seekPending)
+      return; // the seek continues with the next read
+    if (count == 0) {
+      if (readFrame == 0) {
+        readDone = true; // nothing readable at all
+        return;
+      }
+      // truncated file, treat it as if the sequence ended here
+      readFrame = file_header.frame_count;
+      continue;
+    }
+    for (uint32_t i = 0; i < count; i++)
+      ringFrame[tail + i] = readFrame + i;
+    ringFill += count;
+    readFrame += count;
+  }
+}
+
+// write a frame to our LEDs, handlePlayers() shows it
+void FSEQPlayer::processFrameData(const uint8_t *frame_data) {
+  uint8_t layoutCount;
+  const ChannelLayout *layouts = getLayouts(layoutCount);
+  uint8_t pixels[FSEQ_UNPACK_CHUNK * 4];
+  for (uint16_t r = 0; r < pixelRunCount; r++) {
+    const PixelRun &run = pixelRuns[r];
+    const ChannelLayout &l = layouts[run.layout];
+    const uint8_t *src = frame_data + run.dataOffset;
+    if (l.direct) {
+      writePixels(run.led, src, run.pixels, l.white);
+      continue;
+    }
+    // convert to packed RGB(W) a chunk at a time, then write it in bulk
+    const uint8_t stride = 3 + l.white;
+    for (uint16_t done = 0; done < run.pixels;) {
+      uint16_t n = min(uint16_t(run.pixels - done), uint16_t(FSEQ_UNPACK_CHUNK));
+      memset(pixels, 0, n * stride);
+      uint8_t *dst = pixels;
+      for (uint16_t i = 0; i < n; i++, dst += stride, src += l.bytes) {
+        for (uint8_t c = 0; c < l.copies; c++)
+          dst[l.dst[c]] = src[l.src[c]];
+      }
+      writePixels(run.led + done, pixels, n, l.white);
+      done += n;
+    }
+  }
+}
+
+// The primary player writes realtime data to the LEDs. Segment players write
+// into the pixel buffer of their frozen segment instead, which show()
+// composites like any other segment.
+void FSEQPlayer::writePixels(uint16_t led, const uint8_t *data,
+                             uint16_t count, bool rgbw) {
+  if (segment < 0) {
+    setRealtimePixels(led, data, count, rgbw);
+    return;
+  }
+  unsigned len;
+  uint32_t *px = segmentPixels(len);
+  if (!px || led >= len)
+    return;
+  if (count > len - led)
+    count = len - led;
+  // same gamma as realtime data, effects are gamma corrected as well
+  const bool gamma = !arlsDisableGammaCorrection && gammaCorrectCol;
+  const uint8_t stride = 3 + rgbw;
+  for (uint16_t i = 0; i < count; i++, data += stride) {
+    uint32_t c = RGBW32(data[0], data[1], data[2], rgbw ? data[3] : 0);
+    px[led + i] = gamma ? gamma32(c) : c;
+  }
+}
+
+// pixel buffer of our segment and its size, nullptr if the segment is gone
+uint32_t *FSEQPlayer::segmentPixels(unsigned &len) {
+  if (segment < 0 || segment >= int16_t(strip.getSegmentsNum()))
+    return nullptr;
+  Segment &sg = strip.getSegment(segment);
+  if (!sg.allocatePixels())
+    return nullptr;
+  sg.freeze = true; // turning the light off unfreezes all segments
+  len = segmentPixelCount(sg);
+  return sg.pixels;
+}
+
+// pixels of a segment buffer, rows one after the other in 2D
+unsigned FSEQPlayer::segmentPixelCount(const Segment &sg) {
+  return sg.is2D() ? sg.virtualWidth() * sg.virtualHeight()
+                   : sg.virtualLength();
+}
+
+void FSEQPlayer::showFrame() {
+  // keep realtime mode so show() sends our pixels instead of the effects
   realtimeLock(3000, REALTIME_MODE_FSEQ);
-  next_time = now + file_header.step_time;
+  strip.show();
+  lastShow = now;
 }
 
 bool FSEQPlayer::stopBecauseAtTheEnd() {
-  if (!recordingFile.available()) {
-    if (recordingRepeats == RECORDING_REPEAT_LOOP) {
-      // Reset file pointer and frame counter for continuous loop
-      recordingFile.seek(0);
-      frame = 0;
-    } else if (recordingRepeats > 0) {
-      recordingFile.seek(0);
-      recordingRepeats--;
-      frame = 0;
-      DEBUG_PRINTF("Repeat recording again for: %d\n", recordingRepeats);
-    } else {
-      DEBUG_PRINTLN("Finished playing recording, disabling realtime mode");
-      realtimeLock(10, REALTIME_MODE_INACTIVE);
-      recordingFile.close();
-      clearLastPlayback();
-      return true;
-    }
+  if (ringFill == 0 && readDone && queuedReady) {
+    switchToQueued();
+    return false;
+  }
+  if (ringFill == 0 && readDone) {
+    DEBUG_PRINTLN("Finished playing recording");
+    stop();
+    return true;
   }
   return false;
 }
 
-void FSEQPlayer::playNextRecordingFrame() {
-  if (stopBecauseAtTheEnd())
-    return;
-  uint32_t offset = file_header.channel_count * frame++;
-  offset += file_header.channel_data_offset;
-  if (!recordingFile.seek(offset)) {
-    if (recordingFile.position() != offset) {
-      DEBUG_PRINTLN("Failed to seek to proper offset for channel data!");
-      return;
+// Time at which a buffered frame is due. Frames that wrapped around while
+// looping belong to the next pass of the sequence.
+uint32_t FSEQPlayer::frameDueTime(uint32_t f) {
+  if (f < frame)
+    f += file_header.frame_count;
+  return startTime + f * file_header.step_time;
+}
+
+// pop the frame at the ring head and advance the clock to it
+uint32_t FSEQPlayer::consumeRingFrame() {
+  uint32_t f = ringFrame[ringHead];
+  if (f < frame) // looped, the next pass starts where this one ended
+    startTime += file_header.frame_count * file_header.step_time;
+  frame = f + 1;
+  ringHead = (ringHead + 1) % prefetchDepth;
+  ringFill--;
+  return f;
+}
+
+// show the frame at the ring head, false if no LEDs were written
+bool FSEQPlayer::playNextRecordingFrame() {
+  if (ringFill == 0) {
+    // far behind schedule, continue reading at the frame due now
+    uint32_t due = (now - startTime) / file_header.step_time;
+    if (readFrame >= frame && due > readFrame + prefetchDepth &&
+        due < file_header.frame_count) {
+      framesDropped += due - readFrame;
+      frame = due;
+      resetPrefetch(due);
     }
+    // the ring ran dry, this read happens on the critical path
+    if (!readDone)
+      bufferUnderruns++;
+    fillPrefetchRing(1);
+  }
+  if (stopBecauseAtTheEnd())
+    return false;
+  if (ringFill == 0)
+    return false; // nothing could be read, keep showing the previous frame
+  // running late: skip frames whose successor is already due
+  while (ringFill > 1 &&
+         int32_t(now - frameDueTime(
+                           ringFrame[(ringHead + 1) % prefetchDepth])) >= 0) {
+    consumeRingFrame();
+    framesDropped++;
+  }
+  uint8_t slot = ringHead;
+  int32_t late = now - frameDueTime(ringFrame[slot]);
+  uint32_t f = consumeRingFrame();
+  if (late > 0) {
+    frameJitter += (late - frameJitter) / 16.0f;
+    if (uint32_t(late) > maxFrameJitter)
+      maxFrameJitter = late;
   }
-  processFrameData();
+  const uint8_t *data = frameRing + slot * frameSize;
+  if (blendBuffer) {
+    // the slot is refilled soon, keep the frame to fade from
+    memcpy(blendBuffer, data, frameSize);
+    data = blendBuffer;
+    blendReady = true;
+    blendWeight = 0;
+  }
+  processFrameData(data);
+  framesPlayed++;
+  next_time = frameDueTime(f + 1);
+  return true;
+}
+
+// dst = from + (to - from) * weight / 256 for each channel. Two channels are
+// blended per multiply in the even and odd bytes of a 32-bit word.
+void FSEQPlayer::blendFrames(uint8_t *dst, const uint8_t *from,
+                             const uint8_t *to, uint32_t len,
+                             uint16_t weight) {
+  const uint32_t inv = 256 - weight;
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint32_t a, b;
+    memcpy(&a, from + i, 4); // ring slots are not word aligned
+    memcpy(&b, to + i, 4);
+    uint32_t even =
+        (((a & 0x00FF00FF) * inv + (b & 0x00FF00FF) * weight) >> 8) &
+        0x00FF00FF;
+    uint32_t odd =
+        (((a >> 8) & 0x00FF00FF) * inv + ((b >> 8) & 0x00FF00FF) * weight) &
+        0xFF00FF00;
+    uint32_t c = even | odd;
+    memcpy(dst + i, &c, 4);
+  }
+  for (; i < len; i++)
+    dst[i] = (from[i] * inv + to[i] * weight) >> 8;
+}
+
+// Show a crossfade between the shown frame and the next one while waiting
+// for it, false if there is nothing new to show.
+bool FSEQPlayer::playBlendedFrame() {
+  if (!blendBuffer || !blendReady || ringFill == 0 ||
+      ringFrame[ringHead] != frame % file_header.frame_count)
+    return false;
+  uint32_t step = file_header.step_time;
+  if (step <= strip.getFrameTime())
+    return false; // every strip frame already shows a new sequence frame
+  uint32_t left = next_time - now;
+  if (left >= step)
+    return false;
+  uint16_t weight = ((step - left) << 8) / step;
+  if (weight == blendWeight)
+    return false;
+  blendWeight = weight;
+  uint8_t *out = blendBuffer + frameSize;
+  blendFrames(out, blendBuffer, frameRing + ringHead * frameSize, frameSize,
+              weight);
+  processFrameData(out);
+  framesBlended++;
+  return true;
 }
 
-void FSEQPlayer::handlePlayRecording() {
+void FSEQPlayer::handlePlayers() {
   now = millis();
-  if (realtimeMode != REALTIME_MODE_FSEQ)
-    return;
-  if (now < next_time)
-    return;
-  playNextRecordingFrame();
+  // in between frames, crossfades are shown at the strip frame rate
+  bool blend = now - lastShow >= strip.getFrameTime();
+  bool shown = false, segmentShown = false;
+  for (FSEQPlayer &p : players) {
+    if (!p.recordingFile)
+      continue;
+    if (p.isPaused())
+      continue;
+    bool written = false;
+    if (int32_t(now - p.next_time) >= 0)
+      written = p.playNextRecordingFrame();
+    else if (blend)
+      written = p.playBlendedFrame();
+    if (p.segment < 0)
+      shown |= written;
+    else
+      segmentShown |= written;
+  }
+  if (shown) {
+    showFrame();
+  } else if (segmentShown) {
+    strip.trigger(); // the next service() composites the segments
+    lastShow = now;
+  }
+  // spare time until the next frame is due, read ahead
+  scheduleReads();
 }
 
-void FSEQPlayer::loadRecording(const char *filepath, uint16_t startLed,
-                               uint16_t stopLed, float secondsElapsed) {
-  if (recordingFile.available()) {
-    clearLastPlayback();
-    recordingFile.close();
+bool FSEQPlayer::needsRead() const {
+  return frameRing && !readDone && ringFill < prefetchDepth;
+}
+
+// time at which the buffered frames are used up
+uint32_t FSEQPlayer::readDeadline() const {
+  return next_time + ringFill * file_header.step_time;
+}
+
+// Shared read scheduler: while no player has a frame due, the player whose
+// buffer runs dry first gets the next read. Each player gets at most one
+// read per call, so a loop makes one pass over the card ordered by urgency.
+void FSEQPlayer::scheduleReads() {
+  uint32_t served = 0; // bit per player
+  for (;;) {
+    FSEQPlayer *next = nullptr;
+    int32_t nextSlack = INT32_MAX;
+    uint32_t t = millis();
+    for (uint8_t i = 0; i < FSEQ_MAX_PLAYERS; i++) {
+      FSEQPlayer &p = players[i];
+      if (!p.recordingFile || p.isPaused())
+        continue;
+      if (int32_t(t - p.next_time) >= 0)
+        return; // a frame is due, show it first
+      if ((served & (1UL << i)) || !p.needsRead())
+        continue;
+      int32_t slack = int32_t(p.readDeadline() - t);
+      if (slack < nextSlack) {
+        nextSlack = slack;
+        next = &p;
+      }
+    }
+    if (!next)
+      return;
+    served |= 1UL << (next - players);
+    next->fillPrefetchRing(1);
   }
-  playbackLedStart = startLed;
-  playbackLedStop = stopLed;
-  if (playbackLedStart == uint16_t(-1) || playbackLedStop == uint16_t(-1)) {
-    Segment sg = strip.getSegment(-1);
-    playbackLedStart = sg.start;
-    playbackLedStop = sg.stop;
+}
+
+// Open a sequence and buffer its first frames without touching the LEDs or
+// the playback clock. On failure everything opened so far is released.
+bool FSEQPlayer::openRecording(const char *filepath, float secondsElapsed,
+                               int32_t repeats) {
+  if (segment < 0) {
+    windowStart = channelWindowStart;
+    windowCount = channelWindowCount;
   }
-  DEBUG_PRINTF("FSEQ load animation on LED %d to %d\n", playbackLedStart,
-               playbackLedStop);
-  if (fileOnSD(filepath)) {
-    DEBUG_PRINTF("Read file from SD: %s\n", filepath);
-    recordingFile = SD_ADAPTER.open(filepath, "rb");
-    currentFileName = String(filepath);
-    if (currentFileName.startsWith("/"))
-      currentFileName = currentFileName.substring(1);
-  } else if (fileOnFS(filepath)) {
-    DEBUG_PRINTF("Read file from FS: %s\n", filepath);
-  } else {
+  if (!recordingFile.open(filepath)) {
     DEBUG_PRINTF("File %s not found (%s)\n", filepath,
                  USED_STORAGE_FILESYSTEMS);
-    return;
+    return false;
   }
-  if ((uint64_t)recordingFile.available() < sizeof(file_header)) {
+  DEBUG_PRINTF("Read file from %s: %s\n", recordingFile.getStorageName(),
+               filepath);
+  currentFileName = String(filepath);
+  if (currentFileName.startsWith("/"))
+    currentFileName = currentFileName.substring(1);
+  if (recordingFile.available() < FSEQ_FIXED_HEADER_SIZE) {
     DEBUG_PRINTF("Invalid file size: %d\n", recordingFile.available());
-    recordingFile.close();
-    return;
+    releaseRecording();
+    return false;
   }
-  for (int i = 0; i < 4; i++) {
-    file_header.identifier[i] = readUInt8();
+  if (!readHeader(filepath)) {
+    releaseRecording();
+    return false;
+  }
+  if (file_header.major_version >= 2 && !readHeaderTables()) {
+    DEBUG_PRINTF("Error reading FSEQ file %s v2 header\n", filepath);
+    releaseRecording();
+    return false;
   }
-  file_header.channel_data_offset = readUInt16();
-  file_header.minor_version = readUInt8();
-  file_header.major_version = readUInt8();
-  file_header.header_length = readUInt16();
-  file_header.channel_count = readUInt32();
-  file_header.frame_count = readUInt32();
-  file_header.step_time = readUInt8();
-  file_header.flags = readUInt8();
   printHeaderInfo();
-  if (file_header.identifier[0] != 'P' || file_header.identifier[1] != 'S' ||
-      file_header.identifier[2] != 'E' || file_header.identifier[3] != 'Q') {
-    DEBUG_PRINTF("Error reading FSEQ file %s header, invalid identifier\n",
-                 filepath);
-    recordingFile.close();
-    return;
+  switch (file_header.compression_type) {
+  case FSEQ_COMPRESSION_NONE:
+    break;
+  case FSEQ_COMPRESSION_ZLIB:
+    if (file_header.compression_block_count == 0) {
+      DEBUG_PRINTF("Error reading FSEQ file %s, no compression blocks\n",
+                   filepath);
+      releaseRecording();
+      return false;
+    }
+    break;
+  default:
+    // zstd needs a 128 KB+ window, export the sequence as zlib instead
+    DEBUG_PRINTF("Error reading FSEQ file %s, compression %d not supported\n",
+                 filepath, file_header.compression_type);
+    releaseRecording();
+    return false;
   }
-  if (((uint64_t)file_header.channel_count *
+  if (file_header.compression_type == FSEQ_COMPRESSION_NONE &&
+      ((uint64_t)file_header.channel_count *
        (uint64_t)file_header.frame_count) +
           file_header.header_length >
       UINT32_MAX) {
     DEBUG_PRINTF("Error reading FSEQ file %s header, file too long (max 4gb)\n",
                  filepath);
-    recordingFile.close();
-    return;
+    releaseRecording();
+    return false;
   }
   if (file_header.step_time < 1) {
     DEBUG_PRINTF("Invalid step time %d, using default %d instead\n",
                  file_header.step_time, FSEQ_DEFAULT_STEP_TIME);
     file_header.step_time = FSEQ_DEFAULT_STEP_TIME;
   }
-  if (realtimeOverride == REALTIME_OVERRIDE_ONCE) {
-    realtimeOverride = REALTIME_OVERRIDE_NONE;
-  }
   frame = (uint32_t)((secondsElapsed * 1000.0f) / file_header.step_time);
   if (frame >= file_header.frame_count) {
     frame = file_header.frame_count - 1;
   }
-  // Set loop mode if secondsElapsed is exactly 1.0f
-  if (secondsElapsed == 1.0f) {
-    recordingRepeats = RECORDING_REPEAT_LOOP;
+  recordingRepeats = repeats;
+  // short sequences play from PSRAM, the header tables are already read
+  if (preloadLimit)
+    recordingFile.preload(preloadLimit);
+  if (!computeChannelWindow()) {
+    DEBUG_PRINTF("No channels of %s inside the channel window\n", filepath);
+    releaseRecording();
+    return false;
+  }
+  if (!allocatePrefetchRing()) {
+    DEBUG_PRINTF("Not enough memory to buffer %u channels\n",
+                 file_header.channel_count);
+    releaseRecording();
+    return false;
+  }
+  if (file_header.compression_type != FSEQ_COMPRESSION_NONE &&
+      !decompressor.begin(&recordingFile, compressionBlocks,
+                          file_header.compression_block_count, frameStride)) {
+    releaseRecording();
+    return false;
+  }
+  resetPrefetch(frame);
+  fillPrefetchRing(prefetchDepth);
+  return true;
+}
+
+void FSEQPlayer::loadRecording(const char *filepath, uint16_t startLed,
+                               uint16_t stopLed, float secondsElapsed,
+                               int32_t repeats) {
+  if (recordingFile)
+    clearLastPlayback();
+  dropQueued();
+  playbackLedStart = startLed;
+  playbackLedStop = stopLed;
+  if (playbackLedStart == uint16_t(-1) || playbackLedStop == uint16_t(-1)) {
+    const Segment &sg = strip.getSegment(-1); // a copy would duplicate its pixel buffer
+    playbackLedStart = sg.start;
+    playbackLedStop = sg.stop;
+    if (useMainSegmentOnly) {
+      // realtime pixels are counted from the start of the main segment
+      playbackLedStart = 0;
+      playbackLedStop = sg.stop - sg.start;
+    }
+  }
+  DEBUG_PRINTF("FSEQ load animation on LED %d to %d\n", playbackLedStart,
+               playbackLedStop);
+  if (!openRecording(filepath, secondsElapsed, repeats))
+    return;
+  if (segment >= 0) {
+    // the segment shows our frames instead of its effect until we stop
+    Segment &sg = strip.getSegment(segment);
+    segmentWasFrozen = sg.freeze;
+    sg.freeze = true;
   } else {
-    recordingRepeats = RECORDING_REPEAT_DEFAULT;
+    if (realtimeOverride == REALTIME_OVERRIDE_ONCE) {
+      realtimeOverride = REALTIME_OVERRIDE_NONE;
+    }
+    // entering realtime mode clears the LEDs, so do it before the first
+    // frame
+    realtimeLock(3000, REALTIME_MODE_FSEQ);
+  }
+  resetStatistics();
+  now = millis();
+  startTime = now - frame * file_header.step_time;
+  if (!playNextRecordingFrame())
+    return;
+  if (segment < 0)
+    showFrame();
+  else
+    strip.trigger();
+}
+
+FSEQPlayer *FSEQPlayer::forSegment(uint8_t seg) {
+  for (uint8_t i = 1; i < FSEQ_MAX_PLAYERS; i++) {
+    if (players[i].segment == seg && players[i].recordingFile)
+      return &players[i];
+  }
+  return nullptr;
+}
+
+FSEQPlayer *FSEQPlayer::playOnSegment(uint8_t seg, const char *filepath,
+                                      int32_t repeats, uint32_t channelStart) {
+  if (seg >= strip.getSegmentsNum())
+    return nullptr;
+  Segment &sg = strip.getSegment(seg);
+  uint16_t pixels = segmentPixelCount(sg);
+  if (sg.stop <= sg.start || pixels == 0)
+    return nullptr;
+  FSEQPlayer *p = forSegment(seg);
+  for (uint8_t i = 1; i < FSEQ_MAX_PLAYERS && !p; i++) {
+    if (!players[i].recordingFile)
+      p = &players[i];
+  }
+  if (!p) {
+    DEBUG_PRINTF("[FSEQ] No free player for segment %u\n", seg);
+    return nullptr;
+  }
+  p->segment = seg;
+  p->windowStart = channelStart;
+  p->windowCount = 0;
+  p->loadRecording(filepath, 0, pixels, 0.0f, repeats);
+  return p->recordingFile ? p : nullptr;
+}
+
+bool FSEQPlayer::anyPlaying() {
+  for (FSEQPlayer &p : players) {
+    if (p.isPlaying())
+      return true;
   }
-  playNextRecordingFrame();
-  playNextRecordingFrame();
+  return false;
+}
+
+void FSEQPlayer::stopFile(const String &path) {
+  for (FSEQPlayer &p : players) {
+    if (p.isPlaying() && ("/" + p.currentFileName == path ||
+                          (p.queuedReady && "/" + p.queued.fileName == path)))
+      p.stop();
+  }
+}
+
+void FSEQPlayer::resetStatistics() {
+  bufferUnderruns = 0;
+  framesPlayed = 0;
+  framesBlended = 0;
+  framesDropped = 0;
+  syncDrift = 0;
+  syncJumps = 0;
+  seekCount = 0;
+  lastSeekMs = 0;
+  maxSeekMs = 0;
+  frameJitter = 0;
+  maxFrameJitter = 0;
+}
+
+bool FSEQPlayer::queueNext(const char *filepath, int32_t repeats) {
+  if (!isPlaying())
+    return false;
+  dropQueued();
+  // prepare the queued slot with the regular loading code
+  swapQueued();
+  bool ok = openRecording(filepath, 0.0f, repeats);
+  swapQueued();
+  queuedReady = ok;
+  DEBUG_PRINTF("[FSEQ] Queued %s: %s\n", filepath, ok ? "ok" : "failed");
+  return ok;
+}
+
+// Continue with the queued sequence, its first frame is due exactly where
+// the frame after the last one of the finished sequence would have been.
+void FSEQPlayer::switchToQueued() {
+  uint32_t nextStart = startTime + frame * file_header.step_time;
+  releaseRecording();
+  swapQueued();
+  queuedReady = false;
+  resetStatistics();
+  startTime = nextStart - frame * file_header.step_time;
+  next_time = nextStart;
+  DEBUG_PRINTF("[FSEQ] Continuing with %s\n", currentFileName.c_str());
+}
+
+void FSEQPlayer::swapQueued() {
+  std::swap(recordingFile, queued.file);
+  std::swap(currentFileName, queued.fileName);
+  std::swap(recordingRepeats, queued.repeats);
+  std::swap(frame, queued.frame);
+  std::swap(file_header, queued.header);
+  std::swap(compressionBlocks, queued.blocks);
+  std::swap(sparseRanges, queued.sparse);
+  decompressor.swap(queued.decompressor);
+  std::swap(frameStride, queued.frameStride);
+  std::swap(windowOffset, queued.windowOffset);
+  std::swap(pixelRuns, queued.runs);
+  std::swap(pixelRunCount, queued.runCount);
+  std::swap(frameRing, queued.ring);
+  std::swap(blendBuffer, queued.blend);
+  std::swap(blendReady, queued.blendReady);
+  std::swap(ringFrame, queued.ringFrame);
+  std::swap(frameSize, queued.frameSize);
+  std::swap(prefetchDepth, queued.prefetchDepth);
+  std::swap(ringHead, queued.ringHead);
+  std::swap(ringFill, queued.ringFill);
+  std::swap(readFrame, queued.readFrame);
+  std::swap(readSeek, queued.readSeek);
+  std::swap(seekPending, queued.seekPending);
+  std::swap(seekStart, queued.seekStart);
+  std::swap(readDone, queued.readDone);
+}
+
+void FSEQPlayer::dropQueued() {
+  swapQueued();
+  releaseRecording();
+  swapQueued();
+  queuedReady = false;
+}
+
+uint32_t FSEQPlayer::getRemainingMs() {
+  if (!isPlaying())
+    return 0;
+  if (recordingRepeats == RECORDING_REPEAT_LOOP)
+    return UINT32_MAX;
+  // frames still to be read plus the ones buffered
+  uint64_t frames = ringFill;
+  if (readFrame < file_header.frame_count)
+    frames += file_header.frame_count - readFrame;
+  if (recordingRepeats > 0)
+    frames += uint64_t(recordingRepeats) * file_header.frame_count;
+  uint64_t ms = frames * file_header.step_time;
+  return ms > UINT32_MAX ? UINT32_MAX : ms;
 }
 
 void FSEQPlayer::clearLastPlayback() {
-  for (uint16_t i = playbackLedStart; i < playbackLedStop; i++) {
-    setRealtimePixel(i, 0, 0, 0, 0);
+  if (segment < 0) {
+    for (uint16_t i = playbackLedStart; i < playbackLedStop; i++) {
+      setRealtimePixel(i, 0, 0, 0, 0);
+    }
+  } else if (recordingFile) {
+    // hand the segment back to its effect
+    unsigned len;
+    uint32_t *px = segmentPixels(len);
+    if (px) {
+      memset(px, 0, len * sizeof(uint32_t));
+      strip.getSegment(segment).freeze = segmentWasFrozen;
+      strip.trigger();
+    }
+  }
+  releaseRecording();
+  dropQueued();
+}
+
+void FSEQPlayer::stop() {
+  clearLastPlayback();
+  // segment players do not use realtime mode
+  if (segment < 0) {
+    DEBUG_PRINTLN("[FSEQ] Playback stopped, disabling realtime mode");
+    realtimeLock(10, REALTIME_MODE_INACTIVE);
   }
+}
+
+// close the file and free everything allocated for it, LEDs are left as is
+void FSEQPlayer::releaseRecording() {
   if (recordingFile)
     recordingFile.close();
+  freePrefetchRing();
+  freeExtendedHeader();
   frame = 0;
   currentFileName = "";
 }
 
 bool FSEQPlayer::isPlaying() {
-  return recordingFile && recordingFile.available();
+  return recordingFile && (!(readDone && ringFill == 0) || queuedReady);
 }
 
 String FSEQPlayer::getFileName() { return currentFileName; }
@@ -257,39 +1181,44 @@ String FSEQPlayer::getFileName() { return currentFileName; }
 float FSEQPlayer::getElapsedSeconds() {
   if (!isPlaying())
     return 0;
-  // Calculate approximate elapsed seconds based on frame and step time
-  // Or if secondsElapsed is updated elsewhere, return it.
-  // Ideally secondsElapsed should be updated during playback.
-  // But for now, let's just calculate it from frame count
-  return (float)frame * (float)file_header.step_time / 1000.0f;
+  uint32_t elapsed = millis() - startTime;
+  uint32_t duration = file_header.frame_count * file_header.step_time;
+  if (elapsed > duration)
+    elapsed = duration;
+  return elapsed / 1000.0f;
 }
 
+// Phase lock to the master: small offsets are slewed by moving the clock
+// origin at most one frame per sync packet, large ones jump directly.
 void FSEQPlayer::syncPlayback(float secondsElapsed) {
   if (!isPlaying()) {
     DEBUG_PRINTLN("[FSEQ] Sync: Playback not active, cannot sync.");
     return;
   }
+  now = millis();
+  int32_t masterMs = int32_t(secondsElapsed * 1000.0f);
+  int32_t localMs = now - startTime;
+  syncDrift = masterMs - localMs;
+  int32_t step = file_header.step_time;
 
-  // Update internal secondsElapsed if we were tracking it
-  // FSEQPlayer::secondsElapsed = secondsElapsed; // If we were tracking it
-
-  uint32_t expectedFrame =
-      (uint32_t)((secondsElapsed * 1000.0f) / file_header.step_time);
-  int32_t diff = (int32_t)expectedFrame - (int32_t)frame;
-
-  if (abs(diff) > 2) {
+  if (abs(syncDrift) > FSEQ_SYNC_JUMP_FRAMES * step) {
+    uint32_t expectedFrame = masterMs / step;
+    if (expectedFrame >= file_header.frame_count)
+      expectedFrame = file_header.frame_count - 1;
+    startTime = now - masterMs;
     frame = expectedFrame;
-    uint32_t offset =
-        file_header.channel_data_offset + file_header.channel_count * frame;
-    if (recordingFile.seek(offset)) {
-      DEBUG_PRINTF("[FSEQ] Sync: Adjusted frame to %lu (diff=%ld)\n",
-                   expectedFrame, diff);
-    } else {
-      DEBUG_PRINTLN("[FSEQ] Sync: Failed to seek to new frame");
-    }
+    next_time = now;
+    syncJumps++;
+    // buffered frames are stale now, refill from the new position
+    resetPrefetch(frame);
+    fillPrefetchRing(prefetchDepth);
+    DEBUG_PRINTF("[FSEQ] Sync: Jumped to frame %lu (drift=%ld ms)\n",
+                 expectedFrame, syncDrift);
   } else {
-    DEBUG_PRINTF("[FSEQ] Sync: No adjustment needed (current frame: %lu, "
-                 "expected: %lu)\n",
-                 frame, expectedFrame);
+    int32_t slew = constrain(syncDrift / 2, -step, step);
+    startTime -= slew;
+    next_time -= slew;
+    DEBUG_PRINTF("[FSEQ] Sync: drift %ld ms, slewing %ld ms\n", syncDrift,
+                 slew);
   }
-}
\ No newline at end of file
+}
@@ -10,7 +10,42 @@
 #ifndef REALTIME_MODE_FSEQ
 #define REALTIME_MODE_FSEQ 3
 #endif
+// number of full frames read ahead of the playback cursor
+#ifndef FSEQ_PREFETCH_DEPTH
+#define FSEQ_PREFETCH_DEPTH 4
+#endif
+// sync corrections larger than this many frames jump instead of slewing
+#ifndef FSEQ_SYNC_JUMP_FRAMES
+#define FSEQ_SYNC_JUMP_FRAMES 8
+#endif
+// upper bound for the prefetch ring, depth is reduced for very wide frames
+#ifndef FSEQ_PREFETCH_MAX_BYTES
+#define FSEQ_PREFETCH_MAX_BYTES 32768
+#endif
+// remaining play time at which the next queued sequence is opened
+#ifndef FSEQ_GAPLESS_PRELOAD_MS
+#define FSEQ_GAPLESS_PRELOAD_MS 3000
+#endif
+// number of props a channel layout can describe ("RGB:50,RGBW:30,...")
+#ifndef FSEQ_MAX_PROPS
+#define FSEQ_MAX_PROPS 8
+#endif
+// pixels converted per bulk write for layouts that need unpacking
+#ifndef FSEQ_UNPACK_CHUNK
+#define FSEQ_UNPACK_CHUNK 64
+#endif
+// players that can run at the same time, the primary one included
+#ifndef FSEQ_MAX_PLAYERS
+#define FSEQ_MAX_PLAYERS 3
+#endif
+// time a seek may take per loop, longer seeks continue in the next loop
+#ifndef FSEQ_SEEK_BUDGET_US
+#define FSEQ_SEEK_BUDGET_US 2000
+#endif
 
+#include "fseq_decompressor.h"
+#include "fseq_index.h"
+#include "fseq_source.h"
 #include "wled.h"
 #ifdef WLED_USE_SD_SPI
 #include <SD.h>
@@ -19,6 +54,12 @@
 #include "SD_MMC.h"
 #endif
 
+// Plays FSEQ sequences onto a range of LEDs. The primary player serves the
+// web UI, playlists and FPP as realtime data. Further players from a small
+// pool play other sequences into the pixel buffers of frozen segments at the
+// same time, the compositor shows them like effects. All players write their
+// due frames before one show and share one read scheduler, which tops up the
+// buffer that runs dry first.
 class FSEQPlayer {
 public:
   struct FileHeader {
@@ -31,46 +72,282 @@ public:
     uint32_t frame_count;
     uint8_t step_time;
     uint8_t flags;
+    // v2 extended header
+    uint8_t compression_type;
+    uint16_t compression_block_count;
+    uint8_t sparse_range_count;
   };
 
-  static void loadRecording(const char *filepath, uint16_t startLed,
-                            uint16_t stopLed, float secondsElapsed = 0.0f);
-  static void handlePlayRecording();
-  static void clearLastPlayback();
-  static void syncPlayback(float secondsElapsed);
-  static bool isPlaying();
-  static String getFileName();
-  static float getElapsedSeconds();
+  // FSEQ v2 sparse range, the frame only stores these channels
+  struct SparseRange {
+    uint32_t start; // first absolute channel
+    uint32_t count;
+  };
+
+  // byte layout of one prop, table of (source byte, output channel) copies
+  // into a packed RGB or RGBW pixel
+  struct ChannelLayout {
+    uint16_t pixels; // 0 = up to the last LED
+    uint8_t bytes;   // channels per pixel in the sequence
+    uint8_t copies;
+    uint8_t src[8];
+    uint8_t dst[8];
+    bool white;  // output has a white channel
+    bool direct; // sequence data is already packed RGB/RGBW
+  };
+
+  // whole pixels of one prop stored back to back in the frame buffer
+  struct PixelRun {
+    uint32_t dataOffset;
+    uint16_t led;
+    uint16_t pixels;
+    uint8_t layout;
+  };
+
+  // the player used by the web UI, playlists and FPP, it plays on the LED
+  // range given to loadRecording() with the configured channel window and
+  // layout
+  static FSEQPlayer &primary() { return players[0]; }
+  // player attached to a segment, nullptr if it has none
+  static FSEQPlayer *forSegment(uint8_t segment);
+  // play a sequence on a segment next to the primary player, nullptr if all
+  // players are busy. The sequence is read from channelStart (counted from
+  // 0) as RGB data into the segment's pixel buffer, the segment is frozen
+  // until the player stops.
+  static FSEQPlayer *playOnSegment(uint8_t segment, const char *filepath,
+                                   int32_t repeats = RECORDING_REPEAT_DEFAULT,
+                                   uint32_t channelStart = 0);
+  static FSEQPlayer *getPlayer(uint8_t i) {
+    return i < FSEQ_MAX_PLAYERS ? &players[i] : nullptr;
+  }
+  static bool anyPlaying();
+  // stop every player that plays or has queued this file
+  static void stopFile(const String &path);
+  // called from the usermod loop: shows the due frames of all players at
+  // once, then the read scheduler tops up their buffers
+  static void handlePlayers();
+
+  // repeats: number of extra passes, RECORDING_REPEAT_LOOP loops forever
+  void loadRecording(const char *filepath, uint16_t startLed, uint16_t stopLed,
+                     float secondsElapsed = 0.0f,
+                     int32_t repeats = RECORDING_REPEAT_DEFAULT);
+  // open and buffer the sequence that follows the current one, it starts
+  // one frame step after the last frame without blanking in between
+  bool queueNext(const char *filepath,
+                 int32_t repeats = RECORDING_REPEAT_DEFAULT);
+  bool hasQueuedNext() const { return queuedReady; }
+  uint32_t getRemainingMs();
+  // blank our LEDs (or segment) and close the sequence
+  void clearLastPlayback();
+  // clearLastPlayback(), the primary player also leaves realtime mode
+  void stop();
+  void syncPlayback(float secondsElapsed);
+  bool isPlaying();
+  String getFileName();
+  float getElapsedSeconds();
+  int16_t getSegment() const { return segment; } // -1 = primary
+  // "sd", "flash" or "psram" for the playing sequence
+  const char *getStorageName() const { return recordingFile.getStorageName(); }
+
+  // restrict primary playback to a slice of the sequence channels (count 0 =
+  // all), applies to the next loadRecording()
+  static void setChannelWindow(uint32_t start, uint32_t count);
+  static uint32_t getChannelWindowStart() { return channelWindowStart; }
+  static uint32_t getChannelWindowCount() { return channelWindowCount; }
+  // per pixel channel order of the primary sequence, e.g. "RGB", "GRBW", "W"
+  // or "RGBW:30,RGB" for mixed props; applies to the next loadRecording()
+  static bool setChannelLayout(const String &layout);
+  static const String &getChannelLayout() { return channelLayoutSpec; }
+  // sequences up to maxBytes are copied to PSRAM when they are opened and
+  // played without file access (0 = always read from the file)
+  static void setPreloadLimit(uint32_t maxBytes) { preloadLimit = maxBytes; }
+  static uint32_t getPreloadLimit() { return preloadLimit; }
+  // crossfade between frames at the strip frame rate when the sequence step
+  // time is longer, applies to the next loadRecording()
+  static void setInterpolation(bool enable) { interpolate = enable; }
+  static bool getInterpolation() { return interpolate; }
+
+  // prefetch statistics (reported by /api/fseq/status)
+  uint8_t getPrefetchDepth() const { return prefetchDepth; }
+  uint8_t getPrefetchFill() const { return ringFill; }
+  uint32_t getBufferUnderruns() const { return bufferUnderruns; }
+  uint32_t getFramesPlayed() const { return framesPlayed; }
+  uint32_t getFramesBlended() const { return framesBlended; }
+
+  // playback clock statistics (reported by /api/fseq/status)
+  int32_t getSyncDrift() const { return syncDrift; }
+  float getFrameJitter() const { return frameJitter; }
+  uint32_t getMaxFrameJitter() const { return maxFrameJitter; }
+  uint32_t getFramesDropped() const { return framesDropped; }
+  uint32_t getSyncJumps() const { return syncJumps; }
+
+  // time from a seek request to the first frame read at the new position
+  uint32_t getSeekCount() const { return seekCount; }
+  uint32_t getLastSeekMs() const { return lastSeekMs; }
+  uint32_t getMaxSeekMs() const { return maxSeekMs; }
 
 private:
   FSEQPlayer() {}
 
+  // per file state that is exchanged with the playing sequence when
+  // preparing or switching to the queued one
+  struct QueuedSequence {
+    FSEQSource file;
+    String fileName;
+    int32_t repeats = RECORDING_REPEAT_DEFAULT;
+    uint32_t frame = 0;
+    FileHeader header = {};
+    FSEQCompressionBlock *blocks = nullptr;
+    SparseRange *sparse = nullptr;
+    FSEQDecompressor decompressor;
+    uint32_t frameStride = 0;
+    uint32_t windowOffset = 0;
+    PixelRun *runs = nullptr;
+    uint16_t runCount = 0;
+    uint8_t *ring = nullptr;
+    uint8_t *blend = nullptr;
+    bool blendReady = false;
+    uint32_t ringFrame[FSEQ_PREFETCH_DEPTH] = {};
+    uint32_t frameSize = 0;
+    uint8_t prefetchDepth = 0;
+    uint8_t ringHead = 0;
+    uint8_t ringFill = 0;
+    uint32_t readFrame = 0;
+    bool readSeek = true;
+    bool seekPending = false;
+    uint32_t seekStart = 0;
+    bool readDone = false;
+  };
+
   static const int FSEQ_DEFAULT_STEP_TIME = 50;
+  static const int FSEQ_FIXED_HEADER_SIZE = 20;
+  static const int FSEQ_V2_HEADER_SIZE = 32;
+
+  // player pool, players[0] is the primary player
+  static FSEQPlayer players[FSEQ_MAX_PLAYERS];
+  static uint32_t now; // loop time shared by all players
+
+  // configuration of the primary player
+  static uint32_t channelWindowStart;
+  static uint32_t channelWindowCount;
+  static String channelLayoutSpec;
+  static ChannelLayout layouts[FSEQ_MAX_PROPS];
+  static uint8_t layoutCount;
+  static const ChannelLayout rgbLayout; // segment players
+  static uint32_t preloadLimit;
+  static bool interpolate;
+  static uint32_t lastShow;
+
+  int16_t segment = -1; // segment this player is attached to
+  bool segmentWasFrozen = false; // restored when the segment is handed back
+  FSEQSource recordingFile;
+  String currentFileName;
+  int32_t recordingRepeats = RECORDING_REPEAT_DEFAULT;
+  uint32_t next_time = 0;
+  uint16_t playbackLedStart = 0;
+  uint16_t playbackLedStop = uint16_t(-1);
+  uint32_t frame = 0; // next frame expected to be shown
+
+  // playback clock: frame f of the current pass is due at
+  // startTime + f * step_time, independent of render latency
+  uint32_t startTime = 0;
+  int32_t syncDrift = 0; // master position minus local position (ms)
+  float frameJitter = 0; // average lateness of shown frames (ms)
+  uint32_t maxFrameJitter = 0;
+  uint32_t framesDropped = 0;
+  uint32_t syncJumps = 0;
+  FileHeader file_header = {};
+
+  // v2 compression block index and sparse ranges
+  FSEQCompressionBlock *compressionBlocks = nullptr;
+  SparseRange *sparseRanges = nullptr;
+  FSEQDecompressor decompressor;
+
+  // channel window: only frameSize bytes at windowOffset of each stored
+  // frame (frameStride bytes) are read, pixelRuns maps them to LEDs
+  uint32_t windowStart = 0; // first channel, set when a sequence is opened
+  uint32_t windowCount = 0;
+  uint32_t frameStride = 0;
+  uint32_t windowOffset = 0;
+  PixelRun *pixelRuns = nullptr;
+  uint16_t pixelRunCount = 0;
+
+  // prefetch ring: prefetchDepth frames of frameSize bytes each
+  uint8_t *frameRing = nullptr;
+  uint32_t ringFrame[FSEQ_PREFETCH_DEPTH] = {}; // frame number held by slot
+  uint32_t frameSize = 0;
+  uint8_t prefetchDepth = 0;
+  uint8_t ringHead = 0;   // slot of the next frame to be shown
+  uint8_t ringFill = 0;   // number of slots holding unplayed frames
+  uint32_t readFrame = 0; // next frame to be read from file
+  bool readSeek = true;   // file position does not match readFrame
+  bool seekPending = false; // a seek to readFrame is under way
+  uint32_t seekStart = 0;
+  bool readDone = false;  // no more frames to read (end of last repeat)
+  uint32_t bufferUnderruns = 0;
+  uint32_t framesPlayed = 0;
+
+  // interpolation: the shown frame and the crossfade output, frameSize
+  // bytes each; the next frame is the one at the ring head
+  uint8_t *blendBuffer = nullptr;
+  bool blendReady = false; // blendBuffer holds the shown frame
+  uint16_t blendWeight = 0;
+  uint32_t framesBlended = 0;
+  uint32_t seekCount = 0;
+  uint32_t lastSeekMs = 0;
+  uint32_t maxSeekMs = 0;
+
+  QueuedSequence queued;
+  bool queuedReady = false;
+
+  inline uint32_t readUInt32();
+  inline uint32_t readUInt24();
+  inline uint16_t readUInt16();
+  inline uint8_t readUInt8();
 
-  static File recordingFile;
-  static String currentFileName;
-  static float secondsElapsed;
-  static uint8_t colorChannels;
-  static int32_t recordingRepeats;
-  static uint32_t now;
-  static uint32_t next_time;
-  static uint16_t playbackLedStart;
-  static uint16_t playbackLedStop;
-  static uint32_t frame;
-  static uint16_t buffer_size;
-  static FileHeader file_header;
-
-  static inline uint32_t readUInt32();
-  static inline uint32_t readUInt24();
-  static inline uint16_t readUInt16();
-  static inline uint8_t readUInt8();
-
-  static bool fileOnSD(const char *filepath);
-  static bool fileOnFS(const char *filepath);
-  static void printHeaderInfo();
-  static void processFrameData();
-  static bool stopBecauseAtTheEnd();
-  static void playNextRecordingFrame();
+  static void showFrame();
+  static unsigned segmentPixelCount(const Segment &sg);
+  void writePixels(uint16_t led, const uint8_t *data, uint16_t count,
+                   bool rgbw);
+  uint32_t *segmentPixels(unsigned &len);
+  // the primary player pauses while other realtime data owns the LEDs
+  bool isPaused() const {
+    return segment < 0 && realtimeMode != REALTIME_MODE_FSEQ;
+  }
+  static void blendFrames(uint8_t *dst, const uint8_t *from,
+                          const uint8_t *to, uint32_t len, uint16_t weight);
+  bool playBlendedFrame();
+  static void scheduleReads();
+  const ChannelLayout *getLayouts(uint8_t &count) const;
+  void printHeaderInfo();
+  bool openRecording(const char *filepath, float secondsElapsed,
+                     int32_t repeats);
+  void releaseRecording();
+  void swapQueued();
+  void dropQueued();
+  void switchToQueued();
+  void resetStatistics();
+  bool readHeader(const char *filepath);
+  bool readHeaderTables();
+  void freeExtendedHeader();
+  FSEQSeekState seekReadFrame();
+  uint32_t readFrames(uint8_t *dst, uint32_t count);
+  static bool parseChannelLayout(const char *spec, ChannelLayout *out,
+                                 uint8_t &count);
+  uint16_t buildPixelRuns(const SparseRange *window, uint8_t count,
+                          PixelRun *runs);
+  bool computeChannelWindow();
+  bool allocatePrefetchRing();
+  void freePrefetchRing();
+  void resetPrefetch(uint32_t startFrame);
+  bool needsRead() const;
+  uint32_t readDeadline() const;
+  void fillPrefetchRing(uint8_t maxReads);
+  uint32_t frameDueTime(uint32_t f);
+  uint32_t consumeRingFrame();
+  void processFrameData(const uint8_t *frame_data);
+  bool stopBecauseAtTheEnd();
+  bool playNextRecordingFrame();
 };
 
 #endif // FSEQ_PLAYER_H
\ No newline at end of file
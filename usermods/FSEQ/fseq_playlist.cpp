@@ -0,0 +1,203 @@
+#include "fseq_playlist.h"
+#include "usermod_fseq.h"
+
+std::vector<FSEQPlaylist::Entry> FSEQPlaylist::entries;
+String FSEQPlaylist::name = "";
+String FSEQPlaylist::path = "";
+String FSEQPlaylist::autoStartPath = "";
+bool FSEQPlaylist::autoStarted = false;
+bool FSEQPlaylist::active = false;
+bool FSEQPlaylist::shuffle = false;
+bool FSEQPlaylist::loop = true;
+int16_t FSEQPlaylist::current = -1;
+int16_t FSEQPlaylist::queuedIndex = -1;
+bool FSEQPlaylist::queueTried = false;
+uint32_t FSEQPlaylist::lastCheck = 0;
+
+bool FSEQPlaylist::start(const char *file) {
+  String playlistPath = file;
+  if (!playlistPath.startsWith("/"))
+    playlistPath = "/" + playlistPath;
+  stop();
+  if (!load(playlistPath.c_str())) {
+    DEBUG_PRINTF("[FSEQ] Playlist %s could not be loaded\n",
+                 playlistPath.c_str());
+    entries.clear();
+    return false;
+  }
+  path = playlistPath;
+  active = true;
+  lastCheck = millis() - FSEQ_PLAYLIST_RETRY_MS; // start right away
+  // whatever plays now is replaced by the first entry
+  if (FSEQPlayer::primary().isPlaying())
+    FSEQPlayer::primary().clearLastPlayback();
+  DEBUG_PRINTF("[FSEQ] Playlist %s started with %u entries\n", name.c_str(),
+               entries.size());
+  return true;
+}
+
+void FSEQPlaylist::stop() {
+  active = false;
+  entries.clear();
+  name = "";
+  path = "";
+  current = -1;
+  queuedIndex = -1;
+  queueTried = false;
+}
+
+bool FSEQPlaylist::load(const char *file) {
+  File f = SD_ADAPTER.open(file, "r");
+  if (!f)
+    return false;
+  size_t capacity = f.size() * 2 + 256;
+  if (capacity > 16384)
+    capacity = 16384;
+  DynamicJsonDocument doc(capacity);
+  DeserializationError err = deserializeJson(doc, f);
+  f.close();
+  if (err) {
+    DEBUG_PRINTF("[FSEQ] Playlist JSON error: %s\n", err.c_str());
+    return false;
+  }
+  name = doc["name"] | file;
+  shuffle = doc["shuffle"] | false;
+  loop = doc["loop"] | true;
+  entries.clear();
+  for (JsonObject e : doc["entries"].as<JsonArray>()) {
+    const char *seq = e["file"];
+    if (!seq || !*seq)
+      continue;
+    Entry entry;
+    entry.file = seq;
+    if (!entry.file.startsWith("/"))
+      entry.file = "/" + entry.file;
+    int repeat = e["repeat"] | 1;
+    entry.repeat = repeat < 1 ? 1 : repeat;
+    entry.from = parseTime(e["from"] | "");
+    entry.to = parseTime(e["to"] | "");
+    if (entry.from < 0 || entry.to < 0)
+      entry.from = entry.to = -1; // incomplete window, always allowed
+    entries.push_back(entry);
+  }
+  return !entries.empty();
+}
+
+// "HH:MM" to minute of the day, -1 if missing or invalid
+int16_t FSEQPlaylist::parseTime(const char *hhmm) {
+  int h, m;
+  if (!hhmm || sscanf(hhmm, "%d:%d", &h, &m) != 2 || h < 0 || h > 23 ||
+      m < 0 || m > 59)
+    return -1;
+  return h * 60 + m;
+}
+
+// Time windows are only checked when an entry starts, a sequence that is
+// already playing is not cut off at the end of its window.
+bool FSEQPlaylist::entryActive(const Entry &entry) {
+  if (entry.from < 0)
+    return true;
+  int16_t now = hour(localTime) * 60 + minute(localTime);
+  if (entry.from <= entry.to)
+    return now >= entry.from && now < entry.to;
+  return now >= entry.from || now < entry.to; // window across midnight
+}
+
+// Next entry allowed to play after the given one, -1 if there is none.
+// wrapped is set when a sequential playlist ran past its last entry.
+int16_t FSEQPlaylist::pickNext(int16_t after, bool &wrapped) {
+  uint16_t n = entries.size();
+  wrapped = false;
+  if (shuffle) {
+    uint16_t eligible = 0;
+    for (uint16_t i = 0; i < n; i++)
+      if (int16_t(i) != after && entryActive(entries[i]))
+        eligible++;
+    if (eligible == 0)
+      return after >= 0 && entryActive(entries[after]) ? after : -1;
+    uint16_t pick = hw_random(eligible);
+    for (uint16_t i = 0; i < n; i++) {
+      if (int16_t(i) == after || !entryActive(entries[i]))
+        continue;
+      if (pick-- == 0)
+        return i;
+    }
+    return -1;
+  }
+  for (uint16_t k = 1; k <= n; k++) {
+    int32_t i = after + k;
+    if (i >= n) {
+      wrapped = true;
+      if (!loop)
+        return -1;
+      i -= n;
+    }
+    if (entryActive(entries[i]))
+      return i;
+  }
+  return -1;
+}
+
+String FSEQPlaylist::entryPath(int16_t index) { return entries[index].file; }
+
+void FSEQPlaylist::handle() {
+  if (!autoStarted) {
+    autoStarted = true;
+    if (autoStartPath.length())
+      start(autoStartPath.c_str());
+  }
+  if (!active)
+    return;
+
+  if (FSEQPlayer::primary().isPlaying()) {
+    if (queuedIndex >= 0 && !FSEQPlayer::primary().hasQueuedNext()) {
+      // the player continued with the queued entry
+      if (FSEQPlayer::primary().getFileName() == entryPath(queuedIndex).substring(1))
+        current = queuedIndex;
+      queuedIndex = -1;
+      queueTried = false;
+    }
+    if (!queueTried &&
+        FSEQPlayer::primary().getRemainingMs() < FSEQ_GAPLESS_PRELOAD_MS) {
+      queueTried = true;
+      // entries that cannot be opened are skipped
+      int16_t next = current;
+      for (uint16_t tries = 0; tries < entries.size(); tries++) {
+        bool wrapped;
+        next = pickNext(next, wrapped);
+        if (next < 0)
+          break;
+        if (FSEQPlayer::primary().queueNext(entryPath(next).c_str(),
+                                  entries[next].repeat - 1)) {
+          queuedIndex = next;
+          break;
+        }
+      }
+    }
+    return;
+  }
+
+  // nothing playing: start the next entry without gapless transition,
+  // either at the start of the playlist or when queueing was not possible
+  if (millis() - lastCheck < FSEQ_PLAYLIST_RETRY_MS)
+    return;
+  lastCheck = millis();
+  queuedIndex = -1;
+  queueTried = false;
+  for (uint16_t tries = 0; tries < entries.size(); tries++) {
+    bool wrapped;
+    int16_t next = pickNext(current, wrapped);
+    if (next < 0) {
+      if (wrapped && current >= 0) {
+        DEBUG_PRINTF("[FSEQ] Playlist %s finished\n", name.c_str());
+        stop();
+      }
+      return; // all time windows closed, check again later
+    }
+    current = next;
+    FSEQPlayer::primary().loadRecording(entryPath(next).c_str(), 0, uint16_t(-1), 0.0f,
+                              entries[next].repeat - 1);
+    if (FSEQPlayer::primary().isPlaying())
+      return;
+  }
+}
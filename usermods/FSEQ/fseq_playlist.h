@@ -0,0 +1,71 @@
+#ifndef FSEQ_PLAYLIST_H
+#define FSEQ_PLAYLIST_H
+
+#include "fseq_player.h"
+#include "wled.h"
+#include <vector>
+
+// interval in which an idle playlist checks its time windows again
+#ifndef FSEQ_PLAYLIST_RETRY_MS
+#define FSEQ_PLAYLIST_RETRY_MS 1000
+#endif
+
+// Plays the sequences of a playlist file from the SD card one after
+// another. The next entry is queued in FSEQPlayer during the last seconds of
+// the current one, so songs follow each other without a dark frame.
+//
+// Playlist format:
+// {"name": "Evening", "shuffle": false, "loop": true, "entries": [
+//   {"file": "intro.fseq"},
+//   {"file": "song.fseq", "repeat": 2, "from": "17:30", "to": "23:00"}]}
+class FSEQPlaylist {
+public:
+  struct Entry {
+    String file;
+    uint16_t repeat; // number of times the sequence is played
+    int16_t from;    // minute of the day the entry starts, -1 = always
+    int16_t to;      // minute of the day the entry ends
+  };
+
+  // start and stop run in loop() only, like handle(): web requests are
+  // queued, see WebUIManager::handleCommands()
+  static bool start(const char *path);
+  static void stop();
+  // called from the usermod loop before the player is serviced
+  static void handle();
+  // playlist started once after boot (empty = none)
+  static void setAutoStart(const String &path) { autoStartPath = path; }
+  static const String &getAutoStart() { return autoStartPath; }
+
+  static bool isActive() { return active; }
+  static const String &getName() { return name; }
+  static const String &getPath() { return path; }
+  static uint16_t getCount() { return entries.size(); }
+  static int16_t getIndex() { return current; } // -1 = nothing played yet
+  static bool isShuffle() { return shuffle; }
+  static bool isLooping() { return loop; }
+
+private:
+  FSEQPlaylist() {}
+
+  static bool load(const char *file);
+  static int16_t parseTime(const char *hhmm);
+  static bool entryActive(const Entry &entry);
+  static int16_t pickNext(int16_t after, bool &wrapped);
+  static String entryPath(int16_t index);
+
+  static std::vector<Entry> entries;
+  static String name;
+  static String path;
+  static String autoStartPath;
+  static bool autoStarted;
+  static bool active;
+  static bool shuffle;
+  static bool loop;
+  static int16_t current;     // entry being played
+  static int16_t queuedIndex; // entry queued in the player, -1 = none
+  static bool queueTried;     // queueing the next entry was attempted
+  static uint32_t lastCheck;
+};
+
+#endif // FSEQ_PLAYLIST_H
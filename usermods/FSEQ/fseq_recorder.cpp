@@ -0,0 +1,230 @@
+#include "fseq_recorder.h"
+#include "fseq_index.h"
+#include "fseq_player.h"
+#include "usermod_fseq.h"
+
+#define FSEQ_RECORD_HEADER_SIZE 32
+
+volatile FSEQRecorder::State FSEQRecorder::state = FSEQRecorder::IDLE;
+volatile bool FSEQRecorder::stopRequested = false;
+String FSEQRecorder::path = "";
+File FSEQRecorder::file;
+uint8_t *FSEQRecorder::frame = nullptr;
+uint16_t FSEQRecorder::ledCount = 0;
+volatile uint8_t FSEQRecorder::channelsPerLed = 3;
+uint8_t *FSEQRecorder::buffer = nullptr;
+uint32_t FSEQRecorder::bufferLen = 0;
+bool FSEQRecorder::writeError = false;
+uint8_t FSEQRecorder::stepTime = 0;
+uint32_t FSEQRecorder::intervalSum = 0;
+uint16_t FSEQRecorder::intervals = 0;
+uint32_t FSEQRecorder::lastFrameTime = 0;
+uint32_t FSEQRecorder::startTime = 0;
+uint32_t FSEQRecorder::framesWritten = 0;
+uint32_t FSEQRecorder::stopTime = 0;
+
+bool FSEQRecorder::start(const String &filepath, uint8_t step) {
+  if (state != IDLE || frame || FSEQPlayer::anyPlaying())
+    return false;
+  path = filepath.startsWith("/") ? filepath : "/" + filepath;
+  ledCount = strip.getLengthTotal();
+  frame = (uint8_t *)calloc(ledCount, 4);
+  buffer = (uint8_t *)malloc(FSEQ_RECORD_BUFFER_SIZE);
+  if (!frame || !buffer) {
+    DEBUG_PRINTLN("[FSEQ] Not enough memory to record");
+    release();
+    return false;
+  }
+  channelsPerLed = 3;
+  stepTime = step;
+  intervalSum = 0;
+  intervals = 0;
+  lastFrameTime = 0;
+  framesWritten = 0;
+  stopRequested = false;
+  writeError = false;
+  state = ARMED; // set last, the hooks start using the buffers now
+  DEBUG_PRINTF("[FSEQ] Recording %s armed for %u LEDs\n", path.c_str(),
+               ledCount);
+  return true;
+}
+
+void FSEQRecorder::release() {
+  if (frame)
+    free(frame);
+  if (buffer)
+    free(buffer);
+  frame = nullptr;
+  buffer = nullptr;
+}
+
+void FSEQRecorder::addPixels(unsigned start, const uint8_t *data,
+                             unsigned count, bool rgbw) {
+  // the player also writes through setRealtimePixels()
+  if (state == IDLE || realtimeMode == REALTIME_MODE_FSEQ)
+    return;
+  if (start >= ledCount)
+    return;
+  if (count > ledCount - start)
+    count = ledCount - start;
+  // the channel count is fixed when recording starts
+  if (rgbw && state == ARMED)
+    channelsPerLed = 4;
+  uint8_t *dst = frame + start * 4;
+  const unsigned stride = 3 + rgbw;
+  for (unsigned n = 0; n < count; n++, data += stride, dst += 4) {
+    dst[0] = data[0];
+    dst[1] = data[1];
+    dst[2] = data[2];
+    dst[3] = rgbw ? data[3] : 0;
+  }
+}
+
+// FSEQ v2 header without compression blocks and sparse ranges
+void FSEQRecorder::writeHeader(uint8_t *dst) {
+  uint32_t channels = getChannels();
+  memset(dst, 0, FSEQ_RECORD_HEADER_SIZE);
+  memcpy(dst, "PSEQ", 4);
+  dst[4] = FSEQ_RECORD_HEADER_SIZE; // channel data offset
+  dst[6] = 0;                       // minor version
+  dst[7] = 2;                       // major version
+  dst[8] = FSEQ_RECORD_HEADER_SIZE; // header length
+  for (uint8_t i = 0; i < 4; i++) {
+    dst[10 + i] = channels >> (8 * i);
+    dst[14 + i] = framesWritten >> (8 * i);
+  }
+  dst[18] = stepTime;
+  dst[20] = FSEQ_COMPRESSION_NONE;
+  uint32_t id = hw_random();
+  memcpy(dst + 24, &startTime, 4); // unique id
+  memcpy(dst + 28, &id, 4);
+}
+
+bool FSEQRecorder::openFile() {
+  String part = path + ".part";
+  file = SD_ADAPTER.open(part.c_str(), FILE_WRITE);
+  if (!file) {
+    DEBUG_PRINTF("[FSEQ] Cannot create %s\n", part.c_str());
+    return false;
+  }
+  // the header starts the first block, the final frame count is written
+  // when the recording stops
+  writeHeader(buffer);
+  bufferLen = FSEQ_RECORD_HEADER_SIZE;
+  return true;
+}
+
+bool FSEQRecorder::flush() {
+  if (bufferLen && file.write(buffer, bufferLen) != bufferLen) {
+    DEBUG_PRINTLN("[FSEQ] Recording write failed");
+    writeError = true;
+  }
+  bufferLen = 0;
+  return !writeError;
+}
+
+// pack the latest frame into the write buffer
+bool FSEQRecorder::appendFrame() {
+  const uint8_t *src = frame;
+  const uint8_t cpl = channelsPerLed;
+  for (uint16_t led = 0; led < ledCount; led++, src += 4) {
+    for (uint8_t c = 0; c < cpl; c++) {
+      buffer[bufferLen++] = src[c];
+      if (bufferLen == FSEQ_RECORD_BUFFER_SIZE && !flush())
+        return false;
+    }
+  }
+  framesWritten++;
+  return true;
+}
+
+void FSEQRecorder::frameDone() {
+  if (state == IDLE || stopRequested || writeError)
+    return;
+  uint32_t now = millis();
+
+  if (state == ARMED) {
+    if (stepTime == 0) {
+      // average frame interval, ignoring the pause before the stream began
+      if (lastFrameTime && now - lastFrameTime < FSEQ_RECORD_MAX_GAP_MS) {
+        intervalSum += now - lastFrameTime;
+        intervals++;
+      }
+      lastFrameTime = now;
+      if (intervals < FSEQ_RECORD_CADENCE_FRAMES)
+        return;
+      stepTime = constrain((intervalSum + intervals / 2) / intervals, 1, 255);
+    }
+    startTime = now;
+    if (!openFile()) {
+      stopRequested = true;
+      return;
+    }
+    state = RECORDING;
+    DEBUG_PRINTF("[FSEQ] Recording %s, %u channels, step %u ms\n",
+                 path.c_str(), getChannels(), stepTime);
+  }
+
+  uint32_t slot = (now - startTime + stepTime / 2) / stepTime;
+  if (slot < framesWritten)
+    return; // this slot already holds a frame
+  if ((slot - framesWritten) * stepTime > FSEQ_RECORD_MAX_GAP_MS) {
+    // the stream paused, continue right after the last frame
+    startTime = now - framesWritten * stepTime;
+    slot = framesWritten;
+  }
+  // follow the sender's phase slowly, so jitter of frames that arrive near
+  // the middle between two slots does not drop and repeat frames
+  int32_t phase = int32_t(now - startTime) - int32_t(slot * stepTime);
+  startTime += phase / 8;
+  // slots missed by late frames repeat the current one
+  while (framesWritten <= slot)
+    if (!appendFrame())
+      return;
+}
+
+void FSEQRecorder::finish() {
+  if (state == RECORDING && file) {
+    flush();
+    // rewrite the header with the final frame count
+    uint8_t header[FSEQ_RECORD_HEADER_SIZE];
+    writeHeader(header);
+    if (!file.seek(0) || file.write(header, sizeof(header)) != sizeof(header))
+      writeError = true;
+    file.close();
+    String part = path + ".part";
+    if (writeError || framesWritten == 0) {
+      SD_ADAPTER.remove(part.c_str());
+    } else {
+      if (SD_ADAPTER.exists(path.c_str()))
+        SD_ADAPTER.remove(path.c_str());
+      SD_ADAPTER.rename(part.c_str(), path.c_str());
+      FSEQIndex::invalidate();
+    }
+    DEBUG_PRINTF("[FSEQ] Recording %s stopped after %u frames%s\n",
+                 path.c_str(), framesWritten, writeError ? ", write error" : "");
+  }
+  state = IDLE;
+  stopTime = millis();
+}
+
+void FSEQRecorder::handle() {
+  if (state != IDLE && (stopRequested || writeError)) {
+    finish();
+    return;
+  }
+  // the network task may still be inside addPixels() right after stopping
+  if (state == IDLE && frame && millis() - stopTime > 100)
+    release();
+}
+
+const char *FSEQRecorder::getStateName() {
+  switch (state) {
+  case ARMED:
+    return "armed";
+  case RECORDING:
+    return "recording";
+  default:
+    return "idle";
+  }
+}
@@ -0,0 +1,84 @@
+#ifndef FSEQ_RECORDER_H
+#define FSEQ_RECORDER_H
+
+#include "wled.h"
+#ifdef WLED_USE_SD_SPI
+#include <SD.h>
+#include <SPI.h>
+#elif defined(WLED_USE_SD_MMC)
+#include "SD_MMC.h"
+#endif
+
+// write buffer, the file is written in blocks of this size at aligned offsets
+#ifndef FSEQ_RECORD_BUFFER_SIZE
+#define FSEQ_RECORD_BUFFER_SIZE 8192
+#endif
+// frame intervals measured to infer the step time before recording starts
+#ifndef FSEQ_RECORD_CADENCE_FRAMES
+#define FSEQ_RECORD_CADENCE_FRAMES 16
+#endif
+// pauses in the stream longer than this are cut from the recording
+#ifndef FSEQ_RECORD_MAX_GAP_MS
+#define FSEQ_RECORD_MAX_GAP_MS 2000
+#endif
+
+// Records live DDP, E1.31 or UDP realtime data to an uncompressed FSEQ v2
+// file on the SD card ("bridge" mode), so a show streamed once can be
+// replayed without network load.
+//
+// Frames are captured when WLED shows a complete realtime frame. The step
+// time is the average interval of the first frames unless it is given, and
+// frames are then placed on that time grid: late frames repeat the previous
+// slot, extra frames within one slot replace each other.
+class FSEQRecorder {
+public:
+  enum State : uint8_t { IDLE, ARMED, RECORDING };
+
+  // stepTime 0 = infer from the packet cadence
+  static bool start(const String &path, uint8_t stepTime = 0);
+  // finish the file, done by the next handle()
+  static void stop() { stopRequested = true; }
+  static void handle();
+
+  // realtime data hooks, addPixels may run in the network task
+  static void addPixels(unsigned start, const uint8_t *data, unsigned count,
+                        bool rgbw);
+  static void frameDone();
+
+  static State getState() { return state; }
+  static const char *getStateName();
+  static const String &getPath() { return path; }
+  static uint32_t getFrames() { return framesWritten; }
+  static uint8_t getStepTime() { return stepTime; }
+  static uint32_t getChannels() { return ledCount * channelsPerLed; }
+
+private:
+  FSEQRecorder() {}
+
+  static bool openFile();
+  static void writeHeader(uint8_t *dst);
+  static bool appendFrame();
+  static bool flush();
+  static void finish();
+  static void release();
+
+  static volatile State state;
+  static volatile bool stopRequested;
+  static String path;
+  static File file;
+  static uint8_t *frame;      // latest frame, 4 bytes per LED
+  static uint16_t ledCount;
+  static volatile uint8_t channelsPerLed; // 4 once RGBW data was seen
+  static uint8_t *buffer;
+  static uint32_t bufferLen;
+  static bool writeError;
+  static uint8_t stepTime;
+  static uint32_t intervalSum; // cadence measurement while armed
+  static uint16_t intervals;
+  static uint32_t lastFrameTime;
+  static uint32_t startTime; // time of slot 0
+  static uint32_t framesWritten;
+  static uint32_t stopTime;
+};
+
+#endif // FSEQ_RECORDER_H
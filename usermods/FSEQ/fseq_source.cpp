@@ -0,0 +1,131 @@
+#include "fseq_source.h"
+#include "usermod_fseq.h"
+
+bool FSEQSource::open(const char *path) {
+  close();
+  if (SD_ADAPTER.cardType() != CARD_NONE && SD_ADAPTER.exists(path)) {
+    file = SD_ADAPTER.open(path, "rb");
+    storage = file ? SD_CARD : NONE;
+  } else if (WLED_FS.exists(path)) {
+    file = WLED_FS.open(path, "r");
+    storage = file ? FLASH : NONE;
+  }
+  return storage != NONE;
+}
+
+bool FSEQSource::preload(uint32_t maxBytes) {
+  if (storage != SD_CARD && storage != FLASH)
+    return false;
+  uint32_t len = file.size();
+  if (len == 0 || len > maxBytes || !psramSafe || !psramFound())
+    return false;
+  uint8_t *buf = (uint8_t *)ps_malloc(len);
+  if (!buf) {
+    DEBUG_PRINTF("[FSEQ] No PSRAM to preload %u bytes\n", len);
+    return false;
+  }
+  uint32_t done = 0;
+  if (file.seek(0)) {
+    while (done < len) {
+      uint32_t chunk = min(len - done, uint32_t(FSEQ_PRELOAD_CHUNK));
+      size_t n = file.read(buf + done, chunk);
+      if (n == 0)
+        break;
+      done += n;
+      yield();
+    }
+  }
+  if (done != len) {
+    DEBUG_PRINTF("[FSEQ] Preload failed after %u of %u bytes\n", done, len);
+    free(buf);
+    file.seek(0);
+    return false;
+  }
+  file.close();
+  data = buf;
+  dataSize = len;
+  dataPos = 0;
+  storage = MEMORY;
+  DEBUG_PRINTF("[FSEQ] Preloaded %u bytes to PSRAM\n", len);
+  return true;
+}
+
+void FSEQSource::close() {
+  if (file)
+    file.close();
+  if (data)
+    free(data);
+  data = nullptr;
+  dataSize = 0;
+  dataPos = 0;
+  storage = NONE;
+}
+
+size_t FSEQSource::read(uint8_t *dst, size_t len) {
+  if (storage != MEMORY)
+    return storage == NONE ? 0 : file.read(dst, len);
+  if (len > dataSize - dataPos)
+    len = dataSize - dataPos;
+  memcpy(dst, data + dataPos, len);
+  dataPos += len;
+  return len;
+}
+
+bool FSEQSource::seek(uint32_t pos) {
+  if (storage != MEMORY)
+    return storage != NONE && file.seek(pos);
+  if (pos > dataSize)
+    return false;
+  dataPos = pos;
+  return true;
+}
+
+// FAT follows the cluster chain from the start of the file when seeking
+// backwards and from the current cluster when seeking forwards, so the cost
+// of a seek grows with the distance walked. On the card a long seek is
+// split into forward steps of at most FSEQ_SEEK_STEP_BYTES.
+FSEQSeekState FSEQSource::seekToward(uint32_t pos) {
+  if (storage != SD_CARD)
+    return seek(pos) ? FSEQ_SEEK_DONE : FSEQ_SEEK_FAILED;
+  uint32_t cur = file.position();
+  if (cur == pos)
+    return FSEQ_SEEK_DONE;
+  if (pos < cur)
+    cur = 0; // backwards starts over at the first cluster
+  uint32_t next = pos - cur > FSEQ_SEEK_STEP_BYTES ? cur + FSEQ_SEEK_STEP_BYTES
+                                                   : pos;
+  if (!file.seek(next) && file.position() != next)
+    return FSEQ_SEEK_FAILED;
+  return next == pos ? FSEQ_SEEK_DONE : FSEQ_SEEK_PENDING;
+}
+
+size_t FSEQSource::position() {
+  if (storage == MEMORY)
+    return dataPos;
+  return storage == NONE ? 0 : file.position();
+}
+
+int FSEQSource::available() {
+  if (storage == MEMORY)
+    return dataSize - dataPos;
+  return storage == NONE ? 0 : file.available();
+}
+
+size_t FSEQSource::size() {
+  if (storage == MEMORY)
+    return dataSize;
+  return storage == NONE ? 0 : file.size();
+}
+
+const char *FSEQSource::getStorageName() const {
+  switch (storage) {
+  case SD_CARD:
+    return "sd";
+  case FLASH:
+    return "flash";
+  case MEMORY:
+    return "psram";
+  default:
+    return "";
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef FSEQ_SOURCE_H
+#define FSEQ_SOURCE_H
+
+#include "wled.h"
+#ifdef WLED_USE_SD_SPI
+#include <SD.h>
+#include <SPI.h>
+#elif defined(WLED_USE_SD_MMC)
+#include "SD_MMC.h"
+#endif
+
+// bytes read per step while a sequence is copied to PSRAM
+#ifndef FSEQ_PRELOAD_CHUNK
+#define FSEQ_PRELOAD_CHUNK 16384
+#endif
+// largest distance covered by one seek step on the SD card
+#ifndef FSEQ_SEEK_STEP_BYTES
+#define FSEQ_SEEK_STEP_BYTES 1048576
+#endif
+
+// progress of a seek that is done in bounded steps
+enum FSEQSeekState : uint8_t {
+  FSEQ_SEEK_DONE,
+  FSEQ_SEEK_PENDING,
+  FSEQ_SEEK_FAILED
+};
+
+// Storage a sequence is played from. Files on the SD card or in LittleFS are
+// read while they play. A preloaded sequence is copied to PSRAM once when it
+// is opened and then played without any file access.
+//
+// Copies share the open file and the preloaded data like File does, close()
+// releases them.
+class FSEQSource {
+public:
+  enum Storage : uint8_t { NONE, SD_CARD, FLASH, MEMORY };
+
+  // open path on the SD card, or in LittleFS if it is not on the card
+  bool open(const char *path);
+  // copy the open file to PSRAM and close it, false keeps reading the file
+  bool preload(uint32_t maxBytes);
+  void close();
+
+  size_t read(uint8_t *dst, size_t len);
+  bool seek(uint32_t pos);
+  // one bounded step of a seek to pos, call again while it is pending
+  FSEQSeekState seekToward(uint32_t pos);
+  size_t position();
+  int available();
+  size_t size();
+
+  explicit operator bool() const { return storage != NONE; }
+  Storage getStorage() const { return storage; }
+  const char *getStorageName() const;
+  // the underlying file, only valid for SD_CARD and FLASH
+  File &getFile() { return file; }
+
+private:
+  File file;
+  uint8_t *data = nullptr; // preloaded sequence
+  uint32_t dataSize = 0;
+  uint32_t dataPos = 0;
+  Storage storage = NONE;
+};
+
+#endif // FSEQ_SOURCE_H
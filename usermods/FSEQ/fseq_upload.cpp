@@ -0,0 +1,304 @@
+#include "fseq_upload.h"
+#include "fseq_index.h"
+#include "fseq_player.h"
+#include "usermod_fseq.h"
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#include "esp32s3/rom/crc.h"
+#elif defined(CONFIG_IDF_TARGET_ESP32S2)
+#include "esp32s2/rom/crc.h"
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+#include "esp32c3/rom/crc.h"
+#else
+#include "esp32/rom/crc.h"
+#endif
+
+uint8_t *FSEQUpload::buffers[2] = {nullptr, nullptr};
+uint32_t FSEQUpload::bufferLen[2] = {0, 0};
+volatile bool FSEQUpload::bufferReady[2] = {false, false};
+uint8_t FSEQUpload::fillBuffer = 0;
+uint8_t FSEQUpload::writeBuffer = 0;
+uint32_t FSEQUpload::fillTarget = FSEQ_UPLOAD_BUFFER_SIZE;
+volatile bool FSEQUpload::bodyDone = false;
+std::mutex FSEQUpload::fileLock;
+File FSEQUpload::file;
+String FSEQUpload::path = "";
+String FSEQUpload::error = "";
+volatile FSEQUpload::State FSEQUpload::state = FSEQUpload::IDLE;
+uint32_t FSEQUpload::received = 0;
+uint32_t FSEQUpload::total = 0;
+uint32_t FSEQUpload::startOffset = 0;
+bool FSEQUpload::checkCrc = false;
+uint32_t FSEQUpload::expectedCrc = 0;
+uint32_t FSEQUpload::crc = 0;
+uint32_t FSEQUpload::verified = 0;
+uint32_t FSEQUpload::startTime = 0;
+uint32_t FSEQUpload::endTime = 0;
+volatile uint32_t FSEQUpload::lastData = 0;
+
+uint32_t FSEQUpload::partialSize(const String &path) {
+  String part = path + FSEQ_UPLOAD_SUFFIX;
+  if (!SD_ADAPTER.exists(part.c_str()))
+    return 0;
+  File f = SD_ADAPTER.open(part.c_str(), "r");
+  uint32_t size = f ? f.size() : 0;
+  f.close();
+  return size;
+}
+
+bool FSEQUpload::allocateBuffers() {
+  for (uint8_t i = 0; i < 2; i++) {
+    if (!buffers[i])
+      buffers[i] = (uint8_t *)malloc(FSEQ_UPLOAD_BUFFER_SIZE);
+    bufferLen[i] = 0;
+    bufferReady[i] = false;
+  }
+  if (buffers[0] && buffers[1])
+    return true;
+  freeBuffers();
+  return false;
+}
+
+void FSEQUpload::freeBuffers() {
+  for (uint8_t i = 0; i < 2; i++) {
+    if (buffers[i])
+      free(buffers[i]);
+    buffers[i] = nullptr;
+  }
+}
+
+bool FSEQUpload::begin(const String &filepath, uint32_t offset,
+                       uint32_t size, bool withCrc, uint32_t crcValue) {
+  // buffers are released by the loop() task once the last upload ended
+  if (state == RECEIVING || state == VERIFYING || buffers[0]) {
+    DEBUG_PRINTF("[FSEQ] Upload of %s refused, %s is still in progress\n",
+                 filepath.c_str(), path.c_str());
+    return false;
+  }
+  state = IDLE;
+  path = filepath.startsWith("/") ? filepath : "/" + filepath;
+  error = "";
+  received = 0;
+  startTime = lastData = millis();
+  endTime = 0;
+  total = size;
+  checkCrc = withCrc;
+  expectedCrc = crcValue;
+  String part = path + FSEQ_UPLOAD_SUFFIX;
+  if (offset > 0) {
+    // resuming only works exactly at the end of the partial file
+    uint32_t have = partialSize(path);
+    if (have != offset) {
+      DEBUG_PRINTF("[FSEQ] Upload of %s cannot resume at %u, have %u\n",
+                   path.c_str(), offset, have);
+      fail("offset does not match partial file");
+      return false;
+    }
+    file = SD_ADAPTER.open(part.c_str(), FILE_APPEND);
+  } else {
+    if (SD_ADAPTER.exists(part.c_str()))
+      SD_ADAPTER.remove(part.c_str());
+    file = SD_ADAPTER.open(part.c_str(), FILE_WRITE);
+  }
+  if (!file) {
+    fail("cannot open file");
+    return false;
+  }
+  if (!allocateBuffers()) {
+    file.close();
+    fail("not enough memory");
+    return false;
+  }
+  received = startOffset = offset;
+  // the first buffer ends on a buffer boundary, later writes stay aligned
+  fillTarget = FSEQ_UPLOAD_BUFFER_SIZE - offset % FSEQ_UPLOAD_BUFFER_SIZE;
+  fillBuffer = writeBuffer = 0;
+  bodyDone = false;
+  state = RECEIVING;
+  DEBUG_PRINTF("[FSEQ] Upload of %s started at %u\n", path.c_str(), offset);
+  return true;
+}
+
+bool FSEQUpload::write(const uint8_t *data, size_t len) {
+  while (len > 0) {
+    if (state != RECEIVING)
+      return false;
+    if (bufferReady[fillBuffer]) {
+      // both buffers full and loop() is behind, write them from here
+      if (!flushFromWebTask())
+        return false;
+      continue;
+    }
+    uint32_t n = min(uint32_t(len), fillTarget - bufferLen[fillBuffer]);
+    memcpy(buffers[fillBuffer] + bufferLen[fillBuffer], data, n);
+    bufferLen[fillBuffer] += n;
+    received += n;
+    data += n;
+    len -= n;
+    lastData = millis();
+    if (bufferLen[fillBuffer] == fillTarget) {
+      bufferReady[fillBuffer] = true;
+      fillBuffer ^= 1;
+      fillTarget = FSEQ_UPLOAD_BUFFER_SIZE;
+    }
+  }
+  return true;
+}
+
+// the partly filled buffer is written by handle(), the web server task does
+// not touch the buffers after this
+void FSEQUpload::end() { bodyDone = true; }
+
+// The web server task cannot wait for loop(), which may be busy for seconds
+// opening or seeking a sequence. The lock only waits for a buffer write that
+// loop() already started.
+bool FSEQUpload::flushFromWebTask() {
+  const std::lock_guard<std::mutex> lock(fileLock);
+  return state == RECEIVING && writeReadyBuffers();
+}
+
+// called with fileLock held
+bool FSEQUpload::writeReadyBuffers() {
+  while (bufferReady[writeBuffer]) {
+    uint32_t len = bufferLen[writeBuffer];
+    if (file.write(buffers[writeBuffer], len) != len) {
+      fail("write failed, card full?");
+      return false;
+    }
+    bufferLen[writeBuffer] = 0;
+    bufferReady[writeBuffer] = false;
+    writeBuffer ^= 1;
+  }
+  return true;
+}
+
+void FSEQUpload::fail(const char *reason) {
+  error = reason;
+  if (file)
+    file.close();
+  if (!endTime)
+    endTime = millis();
+  state = FAILED;
+  DEBUG_PRINTF("[FSEQ] Upload of %s failed: %s\n", path.c_str(), reason);
+}
+
+// all data is on the card, check size and CRC before replacing the file
+void FSEQUpload::finishWrite() {
+  file.close();
+  endTime = millis();
+  DEBUG_PRINTF("[FSEQ] Upload of %s received %u bytes, %.2f MB/s\n",
+               path.c_str(), received, getThroughput());
+  String part = path + FSEQ_UPLOAD_SUFFIX;
+  if (total && received != total) {
+    SD_ADAPTER.remove(part.c_str()); // cannot be resumed
+    fail("size mismatch");
+    return;
+  }
+  if (!checkCrc) {
+    commit();
+    return;
+  }
+  file = SD_ADAPTER.open(part.c_str(), "r");
+  if (!file) {
+    fail("cannot reopen file");
+    return;
+  }
+  crc = 0;
+  verified = 0;
+  state = VERIFYING;
+}
+
+// the CRC is computed over the data read back from the card, one buffer per
+// loop so playback is not stalled by large files
+void FSEQUpload::verifyStep() {
+  size_t n = file.read(buffers[0], FSEQ_UPLOAD_BUFFER_SIZE);
+  if (n > 0) {
+    crc = crc32_le(crc, buffers[0], n);
+    verified += n;
+    return;
+  }
+  file.close();
+  if (verified != received || crc != expectedCrc) {
+    DEBUG_PRINTF("[FSEQ] Upload CRC %08x, expected %08x\n", crc,
+                 expectedCrc);
+    String part = path + FSEQ_UPLOAD_SUFFIX;
+    SD_ADAPTER.remove(part.c_str());
+    fail("CRC mismatch");
+    return;
+  }
+  commit();
+}
+
+void FSEQUpload::commit() {
+  String part = path + FSEQ_UPLOAD_SUFFIX;
+  // the sequence being replaced may be playing from the old file
+  FSEQPlayer::stopFile(path);
+  if (SD_ADAPTER.exists(path.c_str()))
+    SD_ADAPTER.remove(path.c_str());
+  if (!SD_ADAPTER.rename(part.c_str(), path.c_str())) {
+    fail("rename failed");
+    return;
+  }
+  FSEQIndex::invalidate();
+  state = DONE;
+  DEBUG_PRINTF("[FSEQ] Upload of %s complete\n", path.c_str());
+}
+
+void FSEQUpload::handle() {
+  switch (state) {
+  case RECEIVING: {
+    const std::lock_guard<std::mutex> lock(fileLock);
+    if (!writeReadyBuffers())
+      return;
+    if (bodyDone) {
+      // the web server task is done, hand over the partly filled buffer
+      if (bufferLen[fillBuffer] > 0) {
+        bufferReady[fillBuffer] = true;
+        if (!writeReadyBuffers())
+          return;
+      }
+      finishWrite();
+    } else if (millis() - lastData > FSEQ_UPLOAD_TIMEOUT_MS) {
+      // connection lost: keep what arrived so the upload can be resumed
+      if (bufferLen[fillBuffer] > 0 && !bufferReady[fillBuffer]) {
+        bufferReady[fillBuffer] = true;
+        if (!writeReadyBuffers())
+          return;
+      }
+      fail("timeout, resume at the size of the partial file");
+    }
+    break;
+  }
+  case VERIFYING:
+    verifyStep();
+    break;
+  default:
+    // the web task may still be inside write() until the body ended
+    if (buffers[0] &&
+        (bodyDone || millis() - lastData > FSEQ_UPLOAD_TIMEOUT_MS))
+      freeBuffers();
+    break;
+  }
+}
+
+const char *FSEQUpload::getStateName() {
+  switch (state) {
+  case RECEIVING:
+    return "receiving";
+  case VERIFYING:
+    return "verifying";
+  case DONE:
+    return "done";
+  case FAILED:
+    return "failed";
+  default:
+    return "idle";
+  }
+}
+
+float FSEQUpload::getThroughput() {
+  uint32_t ms = (endTime ? endTime : millis()) - startTime;
+  if (ms == 0)
+    return 0.0f;
+  return (received - startOffset) / 1000.0f / ms;
+}
@@ -0,0 +1,95 @@
+#ifndef FSEQ_UPLOAD_H
+#define FSEQ_UPLOAD_H
+
+#include "wled.h"
+#include <mutex>
+#ifdef WLED_USE_SD_SPI
+#include <SD.h>
+#include <SPI.h>
+#elif defined(WLED_USE_SD_MMC)
+#include "SD_MMC.h"
+#endif
+
+// size of each of the two upload buffers, a multiple of the 512 byte sector
+#ifndef FSEQ_UPLOAD_BUFFER_SIZE
+#define FSEQ_UPLOAD_BUFFER_SIZE 8192
+#endif
+// an upload without data for this long is closed and can be resumed later
+#ifndef FSEQ_UPLOAD_TIMEOUT_MS
+#define FSEQ_UPLOAD_TIMEOUT_MS 10000
+#endif
+// suffix of the file an upload is written to until it is complete
+#define FSEQ_UPLOAD_SUFFIX ".part"
+
+// Receives a file upload into "<path>.part" and renames it to path once all
+// data arrived and the optional CRC32 matched, so an interrupted upload never
+// replaces the existing file.
+//
+// The web server task fills one buffer while the loop() task writes the
+// other to the card, writes are whole buffers at sector aligned offsets.
+// The web server task never waits for loop(): if both buffers are full it
+// writes them to the card itself. The last buffer is written and the file
+// renamed by loop(). An upload can be resumed at the size of its ".part"
+// file.
+class FSEQUpload {
+public:
+  enum State : uint8_t { IDLE, RECEIVING, VERIFYING, DONE, FAILED };
+
+  // start an upload at offset (0 = new file), total 0 = size not known
+  static bool begin(const String &path, uint32_t offset, uint32_t total,
+                    bool checkCrc = false, uint32_t crc = 0);
+  // next part of the body, called from the web server task
+  static bool write(const uint8_t *data, size_t len);
+  // the request body is complete, loop() finishes the upload
+  static void end();
+  // called from the usermod loop, writes buffers and finishes the upload
+  static void handle();
+  // bytes of an interrupted upload of path, where it can be resumed
+  static uint32_t partialSize(const String &path);
+
+  static State getState() { return state; }
+  static const char *getStateName();
+  static const String &getPath() { return path; }
+  static const String &getError() { return error; }
+  static uint32_t getReceived() { return received; }
+  static uint32_t getTotal() { return total; }
+  static float getThroughput(); // MB/s of the last or running upload
+
+private:
+  FSEQUpload() {}
+
+  static bool allocateBuffers();
+  static void freeBuffers();
+  static bool writeReadyBuffers();
+  static bool flushFromWebTask();
+  static void finishWrite();
+  static void verifyStep();
+  static void commit();
+  static void fail(const char *reason);
+
+  static uint8_t *buffers[2];
+  static uint32_t bufferLen[2];
+  static volatile bool bufferReady[2]; // full, owned by the loop() task
+  static uint8_t fillBuffer;           // buffer the web task writes to
+  static uint8_t writeBuffer;          // next buffer to go to the card
+  static uint32_t fillTarget;          // bytes that complete fillBuffer
+  static volatile bool bodyDone;
+
+  static std::mutex fileLock; // file is written by both tasks
+  static File file;
+  static String path;
+  static String error;
+  static volatile State state;
+  static uint32_t received; // bytes of the file including the resumed part
+  static uint32_t total;
+  static uint32_t startOffset;
+  static bool checkCrc;
+  static uint32_t expectedCrc;
+  static uint32_t crc;
+  static uint32_t verified;
+  static uint32_t startTime;
+  static uint32_t endTime;
+  static volatile uint32_t lastData;
+};
+
+#endif // FSEQ_UPLOAD_H
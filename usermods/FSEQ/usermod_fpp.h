@@ -12,64 +12,8 @@
 
 #include <AsyncUDP.h>
 #include <ESPAsyncWebServer.h>
-
-// ----- Minimal WriteBufferingStream Implementation -----
-// This class buffers data before writing it to an underlying Stream.
-class WriteBufferingStream : public Stream {
-public:
-  WriteBufferingStream(Stream &upstream, size_t capacity)
-      : _upstream(upstream) {
-    _capacity = capacity;
-    _buffer = (uint8_t *)malloc(capacity);
-    _offset = 0;
-    if (!_buffer) {
-      DEBUG_PRINTLN(F("[WBS] ERROR: Buffer allocation failed"));
-    }
-  }
-  ~WriteBufferingStream() {
-    flush();
-    if (_buffer)
-      free(_buffer);
-  }
-  // Write a block of data to the buffer
-  size_t write(const uint8_t *buffer, size_t size) override {
-    size_t total = 0;
-    while (size > 0) {
-      size_t space = _capacity - _offset;
-      size_t toCopy = (size < space) ? size : space;
-      memcpy(_buffer + _offset, buffer, toCopy);
-      _offset += toCopy;
-      buffer += toCopy;
-      size -= toCopy;
-      total += toCopy;
-      if (_offset == _capacity)
-        flush();
-    }
-    return total;
-  }
-  // Write a single byte
-  size_t write(uint8_t b) override { return write(&b, 1); }
-  // Flush the buffer to the upstream stream
-  void flush() override {
-    if (_offset > 0) {
-      _upstream.write(_buffer, _offset);
-      _offset = 0;
-    }
-    _upstream.flush();
-  }
-  int available() override { return _upstream.available(); }
-  int read() override { return _upstream.read(); }
-  int peek() override { return _upstream.peek(); }
-
-private:
-  Stream &_upstream;
-  uint8_t *_buffer = nullptr;
-  size_t _capacity = 0;
-  size_t _offset = 0;
-};
-// ----- End WriteBufferingStream -----
-
-#define FILE_UPLOAD_BUFFER_SIZE (563 * 7)
+#include <atomic>
+#include <mutex>
 
 // Definitions for UDP (FPP) synchronization
 #define CTRL_PKT_SYNC 1
@@ -79,6 +23,24 @@ private:
 // UDP port for FPP discovery/synchronization
 const uint16_t UDP_SYNC_PORT = 32320;
 
+// identity reported to FPP
+#define FPP_VERSION_STRING "4.x-dev"
+#define FPP_VERSION_MAJOR 4
+#define FPP_VERSION_MINOR 0
+#define FPP_HARDWARE_TYPE "ESPixelStick-ESP32"
+#define FPP_TYPE_ID 0xC3
+#define FPP_MODE_BRIDGE 0x01
+#define FPP_MODE_REMOTE 0x08
+
+// interval of unsolicited pings announcing this device, 0 = only on request
+#ifndef FPP_PING_INTERVAL_MS
+#define FPP_PING_INTERVAL_MS 30000
+#endif
+// how often the LED setup is checked for changes
+#define FPP_TOPOLOGY_CHECK_MS 1000
+// ping packet v3: 7 byte header and 294 bytes of data
+#define FPP_PING_PACKET_SIZE 301
+
 // Inline functions to write 16-bit and 32-bit values
 static inline void write16(uint8_t *dest, uint16_t value) {
   dest[0] = (value >> 8) & 0xff;
@@ -108,6 +70,55 @@ struct FPPMultiSyncPacket {
 };
 #pragma pack(pop)
 
+// number of UDP commands buffered between the UDP task and loop(), power of 2
+#ifndef FPP_COMMAND_QUEUE_SIZE
+#define FPP_COMMAND_QUEUE_SIZE 16
+#endif
+
+// UDP packet parsed in the AsyncUDP task, applied in loop()
+struct FPPCommand {
+  uint8_t packetType;    // CTRL_PKT_*
+  uint8_t syncAction;    // for CTRL_PKT_SYNC
+  uint8_t pingSubType;   // for CTRL_PKT_PING, 1 = discover request
+  float secondsElapsed;  // master position when the packet arrived
+  uint32_t received;     // micros() at arrival
+  IPAddress remote;      // sender, for ping replies
+  char filename[64];
+};
+
+// Lock-free single producer (AsyncUDP task) / single consumer (loop) ring.
+// Each index is written by one side only, a full queue drops the command.
+class FPPCommandQueue {
+public:
+  bool push(const FPPCommand &cmd) {
+    uint8_t head = _head.load(std::memory_order_relaxed);
+    uint8_t next = (head + 1) & (FPP_COMMAND_QUEUE_SIZE - 1);
+    if (next == _tail.load(std::memory_order_acquire)) {
+      _dropped++;
+      return false;
+    }
+    _items[head] = cmd;
+    _head.store(next, std::memory_order_release);
+    return true;
+  }
+  bool pop(FPPCommand &cmd) {
+    uint8_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+      return false;
+    cmd = _items[tail];
+    _tail.store((tail + 1) & (FPP_COMMAND_QUEUE_SIZE - 1),
+                std::memory_order_release);
+    return true;
+  }
+  uint32_t getDropped() const { return _dropped; }
+
+private:
+  FPPCommand _items[FPP_COMMAND_QUEUE_SIZE];
+  std::atomic<uint8_t> _head{0}; // written by the producer
+  std::atomic<uint8_t> _tail{0}; // written by the consumer
+  uint32_t _dropped = 0;
+};
+
 // UsermodFPP class: Implements FPP (FSEQ/UDP) functionality
 class UsermodFPP : public Usermod {
 private:
@@ -117,11 +128,21 @@ private:
       IPAddress(239, 70, 80, 80);         // Multicast address
   const uint16_t udpPort = UDP_SYNC_PORT; // UDP port
 
-  // Variables for FSEQ file upload
-  File currentUploadFile;
-  String currentUploadFileName = "";
-  unsigned long uploadStartTime = 0;
-  WriteBufferingStream *uploadStream = nullptr;
+  // commands received by the UDP task, applied in loop()
+  FPPCommandQueue commandQueue;
+  FPPCommand commandBatch[FPP_COMMAND_QUEUE_SIZE]; // drained in one loop()
+  uint32_t syncLatency = 0;    // arrival to applied sync of the last one (us)
+  uint32_t maxSyncLatency = 0;
+  uint32_t syncsCoalesced = 0; // syncs replaced by a newer one for the file
+
+  // discovery data built from the bus configuration, rebuilt when the LED
+  // setup, name, address or mode changed
+  uint8_t pingPacket[FPP_PING_PACKET_SIZE];
+  String multiSyncJson;         // read by the web server task
+  std::mutex multiSyncLock;
+  uint32_t topologyHash = 0;
+  uint32_t lastTopologyCheck = 0;
+  uint32_t lastPing = 0;
 
   // Returns device name from server description
   String getDeviceName() { return String(serverDescription); }
@@ -133,13 +154,13 @@ private:
     doc["HostName"] = devName;
     doc["HostDescription"] = devName;
     doc["Platform"] = "ESPixelStick";
-    doc["Variant"] = "ESPixelStick-ESP32";
-    doc["Mode"] = "remote"; // 'remote' or 'bridge'
-    doc["Version"] = "4.x-dev";
+    doc["Variant"] = FPP_HARDWARE_TYPE;
+    doc["Mode"] = getModeName();
+    doc["Version"] = FPP_VERSION_STRING;
 
-    doc["majorVersion"] = 4;
-    doc["minorVersion"] = 0;
-    doc["typeId"] = 195;
+    doc["majorVersion"] = FPP_VERSION_MAJOR;
+    doc["minorVersion"] = FPP_VERSION_MINOR;
+    doc["typeId"] = FPP_TYPE_ID;
     doc["UUID"] = WiFi.macAddress(); // Use standard MAC format
 
     JsonObject utilization = doc.createNestedObject("Utilization");
@@ -164,29 +185,31 @@ private:
     mqtt["connected"] = false;
 
     JsonObject currentPlaylist = doc.createNestedObject("current_playlist");
-    currentPlaylist["count"] = "0";
-    currentPlaylist["description"] = "";
-    currentPlaylist["index"] = "0";
-    currentPlaylist["playlist"] = "";
-    currentPlaylist["type"] = "";
+    bool playlistActive = FSEQPlaylist::isActive();
+    String playlistName = playlistActive ? FSEQPlaylist::getName() : "";
+    currentPlaylist["count"] = String(FSEQPlaylist::getCount());
+    currentPlaylist["description"] = playlistName;
+    currentPlaylist["index"] = String(FSEQPlaylist::getIndex() + 1);
+    currentPlaylist["playlist"] = playlistName;
+    currentPlaylist["type"] = playlistActive ? "sequence" : "";
 
     doc["volume"] = 70;
     doc["media_filename"] = "";
     doc["fppd"] = "running";
     doc["current_song"] = "";
 
-    if (FSEQPlayer::isPlaying()) {
+    if (FSEQPlayer::primary().isPlaying()) {
       doc["current_sequence"] =
-          FSEQPlayer::getFileName(); // You need to ensure getFileName() exists
+          FSEQPlayer::primary().getFileName(); // You need to ensure getFileName() exists
                                      // in FSEQPlayer or track it locally
-      doc["playlist"] = "";
+      doc["playlist"] = playlistName;
       doc["seconds_elapsed"] =
-          String(FSEQPlayer::getElapsedSeconds()); // Assuming float to string
+          String(FSEQPlayer::primary().getElapsedSeconds()); // Assuming float to string
                                                    // conversion needed or
                                                    // handled by JSON
-      doc["seconds_played"] = String(FSEQPlayer::getElapsedSeconds());
+      doc["seconds_played"] = String(FSEQPlayer::primary().getElapsedSeconds());
       // doc["seconds_remaining"] = ...;
-      doc["sequence_filename"] = FSEQPlayer::getFileName();
+      doc["sequence_filename"] = FSEQPlayer::primary().getFileName();
       // doc["time_elapsed"] = ...;
       // doc["time_remaining"] = ...;
       doc["status"] = 1;
@@ -195,7 +218,7 @@ private:
       doc["mode_name"] = "remote";
     } else {
       doc["current_sequence"] = "";
-      doc["playlist"] = "";
+      doc["playlist"] = playlistName;
       doc["seconds_elapsed"] = "0";
       doc["seconds_played"] = "0";
       doc["seconds_remaining"] = "0";
@@ -217,65 +240,124 @@ private:
     return json;
   }
 
-  // Build JSON for FPP multi-sync systems
-  String buildFppdMultiSyncSystemsJSON() {
-    DynamicJsonDocument doc(512);
+  // 'bridge' while realtime data is recorded to the card
+  static bool isBridge() {
+    return FSEQRecorder::getState() != FSEQRecorder::IDLE;
+  }
+  static const char *getModeName() { return isBridge() ? "bridge" : "remote"; }
+
+  // Hash of everything the discovery data is built from
+  uint32_t computeTopologyHash() {
+    uint32_t h = 2166136261u; // FNV-1a
+    auto add = [&h](uint32_t v) {
+      for (uint8_t i = 0; i < 4; i++, v >>= 8)
+        h = (h ^ (v & 0xFF)) * 16777619u;
+    };
+    add(BusManager::getNumBusses());
+    for (unsigned i = 0; i < BusManager::getNumBusses(); i++) {
+      const Bus *bus = BusManager::getBus(i);
+      if (!bus)
+        continue;
+      add(bus->getType() | bus->hasWhite() << 8 | bus->hasRGB() << 9);
+      add(bus->getStart() | uint32_t(bus->getLength()) << 16);
+    }
+    add(FSEQPlayer::getChannelWindowStart());
+    add(uint32_t(WiFi.localIP()));
+    add(isBridge());
+    for (const char *c = serverDescription; *c; c++)
+      add(*c);
+    return h;
+  }
+
+  // Rebuild the ping packet and the multisync JSON from the LED busses.
+  // Every RGB(W) output is reported as a pixel port with 3 or 4 channels per
+  // LED, starting at the channel window of the player.
+  void buildDiscoveryData() {
+    uint32_t channels = 0;
+    DynamicJsonDocument doc(1024 + 32 * BusManager::getNumBusses());
+    JsonObject sys = doc.createNestedArray("systems").createNestedObject();
+    JsonArray pixelCounts = sys.createNestedArray("pixelCounts");
+    uint8_t pixelPorts = 0;
+    for (unsigned i = 0; i < BusManager::getNumBusses(); i++) {
+      const Bus *bus = BusManager::getBus(i);
+      if (!bus || !bus->hasRGB())
+        continue;
+      channels += bus->getLength() * (3 + bus->hasWhite());
+      pixelCounts.add(bus->getLength());
+      if (bus->isDigital())
+        pixelPorts++;
+    }
+    uint32_t first = FSEQPlayer::getChannelWindowStart() + 1;
+    char ranges[24] = "";
+    if (channels)
+      snprintf(ranges, sizeof(ranges), "%u-%u", first, first + channels - 1);
+    IPAddress ip = WiFi.localIP();
+    uint8_t mode = isBridge() ? FPP_MODE_BRIDGE : FPP_MODE_REMOTE;
+
     String devName = getDeviceName();
-    doc["hostname"] = devName;
-    doc["id"] = devName;
-    doc["ip"] = WiFi.localIP().toString();
-    doc["version"] = "4.x-dev";
-    doc["hardwareType"] = "ESPixelStick-ESP32";
-    doc["type"] = 195;
-    doc["num_chan"] = 2052;
-    doc["NumPixelPort"] = 5;
-    doc["NumSerialPort"] = 0;
+    sys["hostname"] = devName;
+    sys["id"] = devName;
+    sys["ip"] = ip.toString();
+    sys["address"] = ip.toString();
+    sys["uuid"] = WiFi.macAddress();
+    sys["version"] = FPP_VERSION_STRING;
+    sys["majorVersion"] = FPP_VERSION_MAJOR;
+    sys["minorVersion"] = FPP_VERSION_MINOR;
+    sys["hardwareType"] = FPP_HARDWARE_TYPE;
+    sys["type"] = FPP_TYPE_ID;
+    sys["typeId"] = FPP_TYPE_ID;
+    sys["fppMode"] = mode;
+    sys["fppModeString"] = getModeName();
+    sys["channelRanges"] = ranges;
+    sys["num_chan"] = channels;
+    sys["NumPixelPort"] = pixelPorts;
+    sys["NumSerialPort"] = 0;
     String json;
     serializeJson(doc, json);
-    return json;
+    {
+      std::lock_guard<std::mutex> lock(multiSyncLock);
+      multiSyncJson = json;
+    }
+
+    // ping packet v3, strings are zero padded fields
+    uint8_t *buf = pingPacket;
+    memset(buf, 0, FPP_PING_PACKET_SIZE);
+    memcpy(buf, "FPPD", 4);
+    buf[4] = CTRL_PKT_PING;
+    write16(buf + 5, FPP_PING_PACKET_SIZE - 7);
+    buf[7] = 0x03; // ping version
+    buf[8] = 0x00; // subtype ping
+    buf[9] = FPP_TYPE_ID;
+    write16(buf + 10, FPP_VERSION_MAJOR);
+    write16(buf + 12, FPP_VERSION_MINOR);
+    buf[14] = mode;
+    for (uint8_t i = 0; i < 4; i++)
+      buf[15 + i] = ip[i];
+    strncpy((char *)buf + 19, devName.c_str(), 64);
+    strncpy((char *)buf + 84, FPP_VERSION_STRING, 40);
+    strncpy((char *)buf + 125, FPP_HARDWARE_TYPE, 40);
+    strncpy((char *)buf + 166, ranges, 120);
+    DEBUG_PRINTF("[FPP] Discovery data: %u channels (%s), %u pixel ports\n",
+                 channels, ranges, pixelPorts);
   }
 
-  // UDP - send a ping packet
+  // Rebuild the discovery data after a configuration change and announce it
+  void updateDiscoveryData() {
+    if (millis() - lastTopologyCheck < FPP_TOPOLOGY_CHECK_MS &&
+        lastTopologyCheck)
+      return;
+    lastTopologyCheck = millis();
+    uint32_t hash = computeTopologyHash();
+    if (hash == topologyHash)
+      return;
+    topologyHash = hash;
+    buildDiscoveryData();
+    lastPing = 0; // announce the change right away
+  }
+
+  // UDP - send the cached ping packet
   void sendPingPacket(IPAddress destination = IPAddress(255, 255, 255, 255)) {
-    uint8_t buf[301];
-    memset(buf, 0, sizeof(buf));
-    buf[0] = 'F';
-    buf[1] = 'P';
-    buf[2] = 'P';
-    buf[3] = 'D';
-    buf[4] = 0x04; // ping type
-    uint16_t dataLen = 294;
-    buf[5] = (dataLen >> 8) & 0xFF;
-    buf[6] = dataLen & 0xFF;
-    buf[7] = 0x03;
-    buf[8] = 0x00;
-    buf[9] = 0xC3;
-    uint16_t versionMajor = 0, versionMinor = 16;
-    buf[10] = (versionMajor >> 8) & 0xFF;
-    buf[11] = versionMajor & 0xFF;
-    buf[12] = (versionMinor >> 8) & 0xFF;
-    buf[13] = versionMinor & 0xFF;
-    buf[14] = 0x08;
-    IPAddress ip = WiFi.localIP();
-    buf[15] = ip[0];
-    buf[16] = ip[1];
-    buf[17] = ip[2];
-    buf[18] = ip[3];
-    String hostName = getDeviceName();
-    if (hostName.length() > 32)
-      hostName = hostName.substring(0, 32);
-    for (int i = 0; i < 32; i++) {
-      buf[19 + i] = (i < hostName.length()) ? hostName[i] : 0;
-    }
-    String verStr = "4.x-dev";
-    for (int i = 0; i < 16; i++) {
-      buf[51 + i] = (i < verStr.length()) ? verStr[i] : 0;
-    }
-    String hwType = "ESPixelStick-ESP32";
-    for (int i = 0; i < 16; i++) {
-      buf[67 + i] = (i < hwType.length()) ? hwType[i] : 0;
-    }
-    udp.writeTo(buf, sizeof(buf), destination, udpPort);
+    udp.writeTo(pingPacket, FPP_PING_PACKET_SIZE, destination, udpPort);
   }
 
   // UDP - send a sync message
@@ -304,48 +386,95 @@ private:
   }
 
   // UDP - process received packet
+  // Runs in the AsyncUDP task: only parse the packet and queue it, SD access
+  // and LED updates happen in loop()
   void processUdpPacket(AsyncUDPPacket packet) {
-    // Print the raw UDP packet in hex format for debugging
-    DEBUG_PRINTLN(F("[FPP] Raw UDP Packet:"));
-    for (size_t i = 0; i < packet.length(); i++) {
-      DEBUG_PRINTF("%02X ", packet.data()[i]);
-    }
-    DEBUG_PRINTLN();
-
-    if (packet.length() < 4)
+    const uint8_t *data = packet.data();
+    size_t len = packet.length();
+    if (len < 5 || data[0] != 'F' || data[1] != 'P' || data[2] != 'P' ||
+        data[3] != 'D')
       return;
-    if (packet.data()[0] != 'F' || packet.data()[1] != 'P' ||
-        packet.data()[2] != 'P' || packet.data()[3] != 'D')
+    FPPCommand cmd = {};
+    cmd.packetType = data[4];
+    cmd.received = micros();
+    cmd.remote = packet.remoteIP();
+    if (cmd.remote == WiFi.localIP())
+      return; // our own broadcast
+    if (cmd.packetType == CTRL_PKT_SYNC) {
+      const size_t nameOfs = offsetof(FPPMultiSyncPacket, filename);
+      if (len <= nameOfs)
+        return;
+      const FPPMultiSyncPacket *syncPacket =
+          reinterpret_cast<const FPPMultiSyncPacket *>(data);
+      cmd.syncAction = syncPacket->sync_action;
+      memcpy(&cmd.secondsElapsed, &syncPacket->seconds_elapsed,
+             sizeof(float));
+      size_t nameLen = min(len - nameOfs, sizeof(cmd.filename) - 1);
+      memcpy(cmd.filename, data + nameOfs, nameLen);
+    } else if (cmd.packetType == CTRL_PKT_PING) {
+      if (len <= 8)
+        return;
+      cmd.pingSubType = data[8];
+    } else if (cmd.packetType != CTRL_PKT_BLANK) {
       return;
-    uint8_t packetType = packet.data()[4];
-    switch (packetType) {
-    case CTRL_PKT_SYNC: {
-      FPPMultiSyncPacket *syncPacket =
-          reinterpret_cast<FPPMultiSyncPacket *>(packet.data());
-      DEBUG_PRINTLN(F("[FPP] Received UDP sync packet"));
-      // Print detailed sync packet information:
-      DEBUG_PRINTF("[FPP] Sync Packet - Action: %d\n", syncPacket->sync_action);
-      DEBUG_PRINT(F("[FPP] Filename: "));
-      DEBUG_PRINTLN(syncPacket->filename);
-      DEBUG_PRINTF("[FPP] Frame Number: %lu\n", syncPacket->frame_number);
-      DEBUG_PRINTF("[FPP] Seconds Elapsed: %.2f\n",
-                   syncPacket->seconds_elapsed);
-      ProcessSyncPacket(syncPacket->sync_action, String(syncPacket->filename),
-                        syncPacket->seconds_elapsed);
-      break;
     }
-    case CTRL_PKT_PING:
-      DEBUG_PRINTLN(F("[FPP] Received UDP ping packet"));
-      sendPingPacket(packet.remoteIP());
-      break;
-    case CTRL_PKT_BLANK:
-      DEBUG_PRINTLN(F("[FPP] Received UDP blank packet"));
-      FSEQPlayer::clearLastPlayback();
-      realtimeLock(10, REALTIME_MODE_INACTIVE);
-      break;
-    default:
-      DEBUG_PRINTLN(F("[FPP] Unknown UDP packet type"));
-      break;
+    commandQueue.push(cmd);
+  }
+
+  static bool isSync(const FPPCommand &cmd) {
+    return cmd.packetType == CTRL_PKT_SYNC && cmd.syncAction == 2;
+  }
+
+  // a later sync of the same file was drained in this pass
+  bool hasNewerSync(uint8_t pos, uint8_t count) const {
+    for (uint8_t i = pos + 1; i < count; i++)
+      if (isSync(commandBatch[i]) &&
+          strcmp(commandBatch[i].filename, commandBatch[pos].filename) == 0)
+        return true;
+    return false;
+  }
+
+  // Apply the queued commands in arrival order. Of the syncs drained in one
+  // pass only the newest per file is applied, each older one would cause a
+  // slew or seek that the newest undoes.
+  void processCommandQueue() {
+    uint8_t count = 0;
+    while (count < FPP_COMMAND_QUEUE_SIZE &&
+           commandQueue.pop(commandBatch[count]))
+      count++;
+    for (uint8_t i = 0; i < count; i++) {
+      const FPPCommand &cmd = commandBatch[i];
+      if (isSync(cmd) && hasNewerSync(i, count)) {
+        syncsCoalesced++;
+        continue;
+      }
+      switch (cmd.packetType) {
+      case CTRL_PKT_SYNC: {
+        // the master moved on while the packet waited in the queue
+        uint32_t latency = micros() - cmd.received;
+        DEBUG_PRINTF("[FPP] Sync action %d for %s at %.2f s\n",
+                     cmd.syncAction, cmd.filename, cmd.secondsElapsed);
+        ProcessSyncPacket(cmd.syncAction, String(cmd.filename),
+                          cmd.secondsElapsed + latency / 1000000.0f);
+        syncLatency = micros() - cmd.received;
+        if (syncLatency > maxSyncLatency)
+          maxSyncLatency = syncLatency;
+        break;
+      }
+      case CTRL_PKT_PING:
+        // only discover requests are answered, plain pings just announce
+        // other systems
+        if (cmd.pingSubType == 1) {
+          DEBUG_PRINTLN(F("[FPP] Received UDP discover ping"));
+          sendPingPacket(cmd.remote);
+        }
+        break;
+      case CTRL_PKT_BLANK:
+        DEBUG_PRINTLN(F("[FPP] Received UDP blank packet"));
+        FSEQPlaylist::stop();
+        FSEQPlayer::primary().stop();
+        break;
+      }
     }
   }
 
@@ -365,23 +494,24 @@ private:
 
     switch (action) {
     case 0: // SYNC_PKT_START
-      FSEQPlayer::loadRecording(fileName.c_str(), 0, strip.getLength(),
+      FSEQPlaylist::stop(); // the master decides what plays
+      FSEQPlayer::primary().loadRecording(fileName.c_str(), 0, strip.getLength(),
                                 secondsElapsed);
       break;
     case 1: // SYNC_PKT_STOP
-      FSEQPlayer::clearLastPlayback();
-      realtimeLock(10, REALTIME_MODE_INACTIVE);
+      FSEQPlaylist::stop();
+      FSEQPlayer::primary().stop();
       break;
     case 2: // SYNC_PKT_SYNC
       DEBUG_PRINTLN(F("[FPP] ProcessSyncPacket: Sync command received"));
       DEBUG_PRINTF("[FPP] Sync Packet - FileName: %s, Seconds Elapsed: %.2f\n",
                    fileName.c_str(), secondsElapsed);
-      if (!FSEQPlayer::isPlaying()) {
+      if (!FSEQPlayer::primary().isPlaying()) {
         DEBUG_PRINTLN(F("[FPP] Sync: Playback not active, starting playback."));
-        FSEQPlayer::loadRecording(fileName.c_str(), 0, strip.getLength(),
+        FSEQPlayer::primary().loadRecording(fileName.c_str(), 0, strip.getLength(),
                                   secondsElapsed);
       } else {
-        FSEQPlayer::syncPlayback(secondsElapsed);
+        FSEQPlayer::primary().syncPlayback(secondsElapsed);
       }
       break;
     case 3: // SYNC_PKT_OPEN
@@ -433,119 +563,62 @@ public:
               });
     server.on("/api/fppd/multiSyncSystems", HTTP_GET,
               [this](AsyncWebServerRequest *request) {
-                request->send(404, "text/plain", "Not Found");
+                String json;
+                {
+                  std::lock_guard<std::mutex> lock(multiSyncLock);
+                  json = multiSyncJson;
+                }
+                request->send(200, "application/json", json);
               });
     // Other API endpoints as needed...
 
-    // Endpoint for file upload (raw, application/octet-stream)
+    // Endpoint for file upload (raw, application/octet-stream). The file is
+    // replaced only after the upload completed, an interrupted upload can be
+    // resumed with an offset parameter or a Content-Range header.
     server.on(
         "/fpp", HTTP_POST,
         [this](AsyncWebServerRequest *request) {
-          if (uploadStream != nullptr) {
-            uploadStream->flush();
-            delete uploadStream;
-            uploadStream = nullptr;
-          }
-          if (currentUploadFile) {
-            currentUploadFile.close();
-          }
-          currentUploadFileName = "";
-          request->send(200, "text/plain", "Upload complete");
+          WebUIManager::sendUploadResult(request);
         },
         NULL,
         [this](AsyncWebServerRequest *request, uint8_t *data, size_t len,
                size_t index, size_t total) {
+          String fileParam = "";
           if (index == 0) {
-            DEBUG_PRINTLN("[FPP] Received upload parameters:");
-            for (uint8_t i = 0; i < request->params(); i++) {
-              AsyncWebParameter *p = request->getParam(i);
-              DEBUG_PRINTF("[FPP] Param %s = %s\n", p->name().c_str(),
-                           p->value().c_str());
-            }
-            String fileParam = "";
             if (request->hasParam("filename")) {
               fileParam = request->arg("filename");
             }
-            DEBUG_PRINTF("[FPP] fileParam = %s\n", fileParam.c_str());
-            currentUploadFileName =
-                (fileParam != "")
-                    ? (fileParam.startsWith("/") ? fileParam : "/" + fileParam)
-                    : "/default.fseq";
-            DEBUG_PRINTF("[FPP] Using filename: %s\n",
-                         currentUploadFileName.c_str());
-            if (SD.exists(currentUploadFileName.c_str())) {
-              SD.remove(currentUploadFileName.c_str());
-            }
-            currentUploadFile =
-                SD.open(currentUploadFileName.c_str(), FILE_WRITE);
-            if (!currentUploadFile) {
-              DEBUG_PRINTLN(F("[FPP] ERROR: Failed to open file for writing"));
-              return;
-            }
-            uploadStream = new WriteBufferingStream(currentUploadFile,
-                                                    FILE_UPLOAD_BUFFER_SIZE);
-            uploadStartTime = millis();
-          }
-          if (uploadStream != nullptr) {
-            uploadStream->write(data, len);
-          }
-          if (index + len >= total) {
-            if (uploadStream != nullptr) {
-              uploadStream->flush();
-              delete uploadStream;
-              uploadStream = nullptr;
-            }
-            currentUploadFile.close();
-            currentUploadFileName = "";
+            DEBUG_PRINTF("[FPP] Upload of %s, %u bytes\n", fileParam.c_str(),
+                         total);
+            if (fileParam == "")
+              fileParam = "/default.fseq";
           }
+          WebUIManager::receiveUpload(request, fileParam, index, data, len,
+                                      index + len >= total, total);
         });
 
     // Endpoint to list FSEQ files on SD card
     server.on("/fseqfilelist", HTTP_GET, [](AsyncWebServerRequest *request) {
-      DynamicJsonDocument doc(1024);
-      JsonArray files = doc.createNestedArray("files");
-
-      File root = SD_ADAPTER.open("/");
-      if (root && root.isDirectory()) {
-        File file = root.openNextFile();
-        while (file) {
-          String name = file.name();
-          if (name.endsWith(".fseq") || name.endsWith(".FSEQ")) {
-            JsonObject fileObj = files.createNestedObject();
-            fileObj["name"] = name;
-            fileObj["size"] = file.size();
-          }
-          file.close();
-          file = root.openNextFile();
-        }
-      } else {
-        doc["error"] = "Cannot open SD root directory";
-      }
-
-      String json;
-      serializeJson(doc, json);
-      request->send(200, "application/json", json);
+      WebUIManager::sendFileList(request, WebUIManager::LIST_FPP);
     });
 
     // Endpoint to start FSEQ playback
     server.on("/fpp/connect", HTTP_GET, [this](AsyncWebServerRequest *request) {
-      if (!request->hasArg("file")) {
-        request->send(400, "text/plain", "Missing 'file' parameter");
+      // started by UsermodFseq::loop(), see WebUIManager::handleCommands()
+      FSEQCommand cmd = {};
+      if (!WebUIManager::commandFile(request, cmd))
         return;
-      }
-      String filepath = request->arg("file");
-      if (!filepath.startsWith("/")) {
-        filepath = "/" + filepath;
-      }
-      // Use FSEQPlayer to start playback
-      FSEQPlayer::loadRecording(filepath.c_str(), 0, strip.getLength());
-      request->send(200, "text/plain", "FPP connect started: " + filepath);
+      cmd.action = FSEQCommand::PLAY;
+      cmd.stopLed = strip.getLength();
+      cmd.repeats = RECORDING_REPEAT_DEFAULT;
+      WebUIManager::queueCommand(request, cmd,
+                                 String("FPP connect queued: ") + cmd.filepath);
     });
     // Endpoint to stop FSEQ playback
     server.on("/fpp/stop", HTTP_GET, [this](AsyncWebServerRequest *request) {
-      FSEQPlayer::clearLastPlayback();
-      realtimeLock(10, REALTIME_MODE_INACTIVE);
-      request->send(200, "text/plain", "FPP connect stopped");
+      FSEQCommand cmd = {};
+      cmd.action = FSEQCommand::STOP;
+      WebUIManager::queueCommand(request, cmd, "FPP connect stop queued");
     });
 
     // Initialize UDP listener for synchronization and ping
@@ -569,8 +642,28 @@ public:
         DEBUG_PRINTLN(F("[FPP] UDP listener started on multicast"));
       }
     }
-    // Process FSEQ playback
-    FSEQPlayer::handlePlayRecording();
+    updateDiscoveryData();
+    // Apply received sync commands, then process FSEQ playback
+    processCommandQueue();
+    if (udpStarted && (!lastPing || (FPP_PING_INTERVAL_MS &&
+                                     millis() - lastPing > FPP_PING_INTERVAL_MS))) {
+      sendPingPacket();
+      lastPing = millis();
+    }
+    FSEQPlayer::handlePlayers();
+  }
+
+  // Sync latency in the Info tab
+  void addToJsonInfo(JsonObject &root) override {
+    JsonObject user = root["u"];
+    if (user.isNull())
+      user = root.createNestedObject("u");
+    JsonArray arr = user.createNestedArray("FPP sync latency");
+    arr.add(String(syncLatency / 1000.0f, 2) + " ms (max " +
+            String(maxSyncLatency / 1000.0f, 2) + " ms)");
+    arr = user.createNestedArray("FPP sync coalesced/dropped");
+    arr.add(String(syncsCoalesced) + " / " +
+            String(commandQueue.getDropped()));
   }
 
   uint16_t getId() { return USERMOD_ID_SD_CARD; }
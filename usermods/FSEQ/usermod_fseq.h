@@ -43,7 +43,11 @@
 #ifndef SPI_PORT_DEFINED
 inline SPIClass spiPort = SPIClass(SPI);
 #define SPI_PORT_DEFINED
+#include "../usermods/FSEQ/fseq_index.h"
 #include "../usermods/FSEQ/fseq_player.h"
+#include "../usermods/FSEQ/fseq_playlist.h"
+#include "../usermods/FSEQ/fseq_recorder.h"
+#include "../usermods/FSEQ/fseq_upload.h"
 #include "../usermods/FSEQ/sd_manager.h"
 #include "../usermods/FSEQ/web_ui_manager.h"
 #include "wled.h"
@@ -67,6 +71,7 @@ public:
       DEBUG_PRINTF("[%s] SD initialization FAILED.\n", FPSTR(_name));
     } else {
       DEBUG_PRINTF("[%s] SD initialization successful.\n", FPSTR(_name));
+      FSEQIndex::begin();
     }
 
     // Register web endpoints defined in WebUIManager
@@ -75,10 +80,24 @@ public:
 
   // Loop function called continuously
   void loop() {
-    // Process FSEQ playback (includes UDP sync commands)
-    FSEQPlayer::handlePlayRecording();
+    // Store uploaded data, finish a stopped recording, update the file index,
+    // advance the playlist, apply web requests, then process playback
+    FSEQUpload::handle();
+    FSEQRecorder::handle();
+    FSEQIndex::handle();
+    FSEQPlaylist::handle();
+    WebUIManager::handleCommands();
+    FSEQPlayer::handlePlayers();
   }
 
+  // Realtime data for the recorder, see FSEQRecorder
+  void onRealtimePixels(unsigned start, const uint8_t *data, unsigned count,
+                        bool rgbw) override {
+    FSEQRecorder::addPixels(start, data, count, rgbw);
+  }
+
+  void onRealtimeShow() override { FSEQRecorder::frameDone(); }
+
   // Unique ID for the usermod
   uint16_t getId() override { return USERMOD_ID_SD_CARD; }
 
@@ -95,10 +114,18 @@ public:
     arr.add("http://" + ip + "/fsequi"); // value
   }
 
-  // Save your SPI pins to WLED config JSON
+  // Save your SPI pins and the channel window to WLED config JSON
   void addToConfig(JsonObject &root) override {
-#ifdef WLED_USE_SD_SPI
     JsonObject top = root.createNestedObject(FPSTR(_name));
+    // channels are numbered from 1 like in xLights/FPP, count 0 = all
+    top["startChannel"] = FSEQPlayer::getChannelWindowStart() + 1;
+    top["channelCount"] = FSEQPlayer::getChannelWindowCount();
+    top["channelLayout"] = FSEQPlayer::getChannelLayout();
+    top["playlist"] = FSEQPlaylist::getAutoStart();
+    // sequences up to this size play from PSRAM, 0 = off
+    top["preloadKB"] = FSEQPlayer::getPreloadLimit() / 1024;
+    top["interpolate"] = FSEQPlayer::getInterpolation();
+#ifdef WLED_USE_SD_SPI
     top["csPin"] = configPinSourceSelect;
     top["sckPin"] = configPinSourceClock;
     top["misoPin"] = configPinPoci;
@@ -106,13 +133,22 @@ public:
 #endif
   }
 
-  // Read your SPI pins from WLED config JSON
+  // Read your SPI pins and the channel window from WLED config JSON
   bool readFromConfig(JsonObject &root) override {
-#ifdef WLED_USE_SD_SPI
     JsonObject top = root[FPSTR(_name)];
     if (top.isNull())
       return false;
 
+    uint32_t startChannel = top["startChannel"] | 1;
+    uint32_t channelCount = top["channelCount"] | 0;
+    FSEQPlayer::setChannelWindow(startChannel > 0 ? startChannel - 1 : 0,
+                                 channelCount);
+    FSEQPlayer::setChannelLayout(top["channelLayout"] | "RGB");
+    FSEQPlaylist::setAutoStart(top["playlist"] | "");
+    FSEQPlayer::setPreloadLimit((top["preloadKB"] | 0) * 1024);
+    FSEQPlayer::setInterpolation(top["interpolate"] | false);
+
+#ifdef WLED_USE_SD_SPI
     if (top["csPin"].is<int>())
       configPinSourceSelect = top["csPin"].as<int>();
     if (top["sckPin"].is<int>())
@@ -123,10 +159,8 @@ public:
       configPinPico = top["mosiPin"].as<int>();
 
     reinit_SD_SPI(); // reinitialize SD with new pins
-    return true;
-#else
-    return false;
 #endif
+    return true;
   }
 
 #ifdef WLED_USE_SD_SPI
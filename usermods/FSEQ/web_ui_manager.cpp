@@ -1,7 +1,12 @@
 #include "web_ui_manager.h"
+#include "fseq_index.h"
 #include "fseq_player.h"
+#include "fseq_playlist.h"
+#include "fseq_recorder.h"
+#include "fseq_upload.h"
 #include "sd_manager.h"
 #include "usermod_fseq.h"
+#include <memory>
 
 static const char PAGE_HTML[] PROGMEM = R"rawliteral(
 <!DOCTYPE html>
@@ -216,6 +221,279 @@ static const char PAGE_HTML[] PROGMEM = R"rawliteral(
 </html>
 )rawliteral";
 
+// State of a streamed file listing. Entries are taken from the file index
+// one at a time and rendered into a small buffer, so memory use does not
+// depend on the number of files on the card.
+struct FileListStream {
+  uint8_t format;
+  String ext;       // lower case extensions separated by ',', empty = all
+  uint16_t pos = 0; // next index entry
+  uint16_t skip;    // matching entries still to skip
+  uint16_t left;    // entries still to send, 0 = no limit
+  bool limited;
+  bool first = true;
+  uint8_t stage = 0; // 0 = opening, 1 = entries, 2 = done
+  String chunk;      // rendered text not yet handed to the server
+  size_t chunkOfs = 0;
+
+  bool matches(const String &name) const {
+    if (ext.length() == 0)
+      return true;
+    int dot = name.lastIndexOf('.');
+    if (dot < 0)
+      return false;
+    String e = name.substring(dot + 1);
+    e.toLowerCase();
+    int from = 0;
+    while (from <= (int)ext.length()) {
+      int comma = ext.indexOf(',', from);
+      if (comma < 0)
+        comma = ext.length();
+      if (ext.substring(from, comma) == e)
+        return true;
+      from = comma + 1;
+    }
+    return false;
+  }
+
+  void renderEntry(const FSEQIndex::Entry &e) {
+    chunk = first ? "{" : ",{";
+    first = false;
+    chunk += "\"name\":\"" + e.name + "\"";
+    if (format == WebUIManager::LIST_SD) {
+      chunk += ",\"size\":" + String(e.info.size / 1024.0, 2);
+    } else {
+      chunk += ",\"size\":" + String(e.info.size);
+    }
+    if (format == WebUIManager::LIST_FSEQ) {
+      chunk += ",\"valid\":";
+      chunk += (e.info.sequence ? "true" : "false");
+      chunk += ",\"frames\":" + String(e.info.frameCount);
+      chunk += ",\"step\":" + String(e.info.stepTime);
+      chunk += ",\"channels\":" + String(e.info.channelCount);
+      chunk += ",\"duration\":" + String(e.durationMs());
+    }
+    chunk += "}";
+  }
+
+  // render the next piece of the response into chunk, false when done
+  bool next() {
+    chunkOfs = 0;
+    switch (stage) {
+    case 0:
+      chunk = format == WebUIManager::LIST_FPP ? "{\"files\":[" : "[";
+      stage = 1;
+      return true;
+    case 1: {
+      FSEQIndex::Entry e;
+      while ((!limited || left > 0) && FSEQIndex::getEntry(pos++, e)) {
+        if (!matches(e.name))
+          continue;
+        if (skip > 0) {
+          skip--;
+          continue;
+        }
+        if (limited)
+          left--;
+        renderEntry(e);
+        return true;
+      }
+      chunk = format == WebUIManager::LIST_FPP ? "]}" : "]";
+      stage = 2;
+      return true;
+    }
+    default:
+      chunk = "";
+      return false;
+    }
+  }
+
+  size_t fill(uint8_t *buf, size_t maxLen) {
+    size_t len = 0;
+    while (len < maxLen) {
+      if (chunkOfs < chunk.length()) {
+        size_t n = min(maxLen - len, chunk.length() - chunkOfs);
+        memcpy(buf + len, chunk.c_str() + chunkOfs, n);
+        chunkOfs += n;
+        len += n;
+      } else if (!next()) {
+        break;
+      }
+    }
+    return len;
+  }
+};
+
+// Send a listing as a chunked response. Query parameters: ext (extensions
+// separated by ','), offset (entries to skip) and limit (0 = all).
+void WebUIManager::sendFileList(AsyncWebServerRequest *request,
+                                uint8_t format) {
+  auto state = std::make_shared<FileListStream>();
+  state->format = format;
+  if (request->hasArg("ext"))
+    state->ext = request->arg("ext");
+  else if (format != LIST_SD)
+    state->ext = "fseq";
+  state->ext.toLowerCase();
+  state->ext.replace(".", "");
+  state->ext.replace(" ", "");
+  state->skip = request->hasArg("offset") ? request->arg("offset").toInt() : 0;
+  state->left = request->hasArg("limit") ? request->arg("limit").toInt() : 0;
+  state->limited = state->left > 0;
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+      "application/json", [state](uint8_t *buf, size_t maxLen, size_t) {
+        return state->fill(buf, maxLen);
+      });
+  request->send(response);
+}
+
+// request whose body is being received by FSEQUpload
+AsyncWebServerRequest *WebUIManager::uploadRequest = nullptr;
+
+// Start an upload with the resume offset and checks of the request:
+// offset (or a Content-Range header), size of the complete file and crc
+// (CRC32 of the complete file in hex). bodyLength is the size of this
+// request body when it is known.
+bool WebUIManager::beginUpload(AsyncWebServerRequest *request,
+                               const String &filename, uint32_t bodyLength) {
+  uint32_t offset = 0, total = 0;
+  if (request->hasArg("offset"))
+    offset = strtoul(request->arg("offset").c_str(), nullptr, 10);
+  if (request->hasHeader("Content-Range")) {
+    // "bytes first-last/size"
+    unsigned long first, last, size;
+    const char *range = request->getHeader("Content-Range")->value().c_str();
+    if (sscanf(range, "bytes %lu-%lu/%lu", &first, &last, &size) == 3) {
+      offset = first;
+      total = size;
+    }
+  }
+  if (request->hasArg("size"))
+    total = strtoul(request->arg("size").c_str(), nullptr, 10);
+  else if (!total && bodyLength)
+    total = offset + bodyLength;
+  bool checkCrc = request->hasArg("crc");
+  uint32_t crc =
+      checkCrc ? strtoul(request->arg("crc").c_str(), nullptr, 16) : 0;
+  if (!FSEQUpload::begin(filename, offset, total, checkCrc, crc))
+    return false;
+  uploadRequest = request;
+  return true;
+}
+
+// Pass a part of a request body to the upload. Parts of a request that was
+// refused are dropped so they cannot end up in another upload.
+void WebUIManager::receiveUpload(AsyncWebServerRequest *request,
+                                 const String &filename, size_t index,
+                                 const uint8_t *data, size_t len, bool final,
+                                 uint32_t bodyLength) {
+  if (index == 0)
+    beginUpload(request, filename, bodyLength);
+  if (request != uploadRequest)
+    return;
+  FSEQUpload::write(data, len);
+  if (final)
+    FSEQUpload::end();
+}
+
+void WebUIManager::sendUploadResult(AsyncWebServerRequest *request) {
+  bool own = request == uploadRequest;
+  uploadRequest = nullptr;
+  if (!own || FSEQUpload::getState() == FSEQUpload::FAILED) {
+    String error = FSEQUpload::getState() == FSEQUpload::FAILED
+                       ? FSEQUpload::getError()
+                       : String("another upload is in progress");
+    request->send(own ? 500 : 409, "text/plain", "Upload failed: " + error);
+    return;
+  }
+  if (FSEQUpload::getState() == FSEQUpload::DONE) {
+    request->send(200, "text/plain",
+                  "Upload complete (" +
+                      String(FSEQUpload::getThroughput(), 2) + " MB/s)");
+    return;
+  }
+  // loop() still writes the last buffer, checks size and CRC and renames the
+  // file, the result is reported by the status endpoint
+  request->send(202, "text/plain",
+                "Upload received, finishing: see /api/sd/upload/status");
+}
+
+// stop the playlist and the current sequence, hand the LEDs back to WLED
+static void stopPlayback() {
+  FSEQPlaylist::stop();
+  FSEQPlayer::primary().clearLastPlayback();
+  if (realtimeOverride == REALTIME_OVERRIDE_ONCE)
+    realtimeOverride = REALTIME_OVERRIDE_NONE;
+  if (realtimeMode)
+    exitRealtime();
+  else {
+    realtimeMode = REALTIME_MODE_INACTIVE;
+    strip.trigger();
+  }
+}
+
+// playback requests accepted by the web server task, applied in loop()
+FSEQCommandQueue WebUIManager::commandQueue;
+
+bool WebUIManager::commandFile(AsyncWebServerRequest *request,
+                               FSEQCommand &cmd) {
+  if (!request->hasArg("file")) {
+    request->send(400, "text/plain", "Missing file param");
+    return false;
+  }
+  String filepath = request->arg("file");
+  if (!filepath.startsWith("/"))
+    filepath = "/" + filepath;
+  if (filepath.length() >= sizeof(cmd.filepath)) {
+    request->send(400, "text/plain", "File name too long");
+    return false;
+  }
+  strlcpy(cmd.filepath, filepath.c_str(), sizeof(cmd.filepath));
+  return true;
+}
+
+void WebUIManager::queueCommand(AsyncWebServerRequest *request,
+                                const FSEQCommand &cmd,
+                                const String &message) {
+  if (!commandQueue.push(cmd)) {
+    request->send(503, "text/plain", "Too many playback requests");
+    return;
+  }
+  request->send(202, "text/plain", message);
+}
+
+void WebUIManager::handleCommands() {
+  FSEQCommand cmd;
+  while (commandQueue.pop(cmd)) {
+    switch (cmd.action) {
+    case FSEQCommand::PLAY:
+      FSEQPlaylist::stop();
+      FSEQPlayer::primary().loadRecording(cmd.filepath, 0, cmd.stopLed, 0.0f,
+                                          cmd.repeats);
+      break;
+    case FSEQCommand::STOP:
+      stopPlayback();
+      break;
+    case FSEQCommand::SEGMENT_PLAY:
+      if (!FSEQPlayer::playOnSegment(cmd.segment, cmd.filepath, cmd.repeats,
+                                     cmd.channelStart))
+        DEBUG_PRINTF("[FSEQ] Cannot play %s on segment %u\n", cmd.filepath,
+                     cmd.segment);
+      break;
+    case FSEQCommand::PLAYLIST:
+      if (!FSEQPlaylist::start(cmd.filepath))
+        DEBUG_PRINTF("[FSEQ] Invalid playlist %s\n", cmd.filepath);
+      break;
+    case FSEQCommand::SEGMENT_STOP: {
+      FSEQPlayer *p = FSEQPlayer::forSegment(cmd.segment);
+      if (p)
+        p->stop();
+      break;
+    }
+    }
+  }
+}
+
 void WebUIManager::registerEndpoints() {
 
   // Main UI page (navigation, SD and FSEQ tabs)
@@ -225,74 +503,42 @@ void WebUIManager::registerEndpoints() {
 
   // API - List SD files (size in KB)
   server.on("/api/sd/list", HTTP_GET, [](AsyncWebServerRequest *request) {
-    File root = SD_ADAPTER.open("/");
-    String json = "[";
-    if (root && root.isDirectory()) {
-      bool first = true;
-      File file = root.openNextFile();
-      while (file) {
-        if (!first)
-          json += ",";
-        first = false;
-        float sizeKB = file.size() / 1024.0;
-        json += "{";
-        json += "\"name\":\"" + String(file.name()) + "\",";
-        json += "\"size\":" + String(sizeKB, 2);
-        json += "}";
-        file.close();
-        file = root.openNextFile();
-      }
-    }
-    root.close();
-    json += "]";
-    request->send(200, "application/json", json);
+    sendFileList(request, LIST_SD);
   });
 
-  // API - List FSEQ files
+  // API - List FSEQ files with their header data
   server.on("/api/fseq/list", HTTP_GET, [](AsyncWebServerRequest *request) {
-    File root = SD_ADAPTER.open("/");
-    String json = "[";
-    if (root && root.isDirectory()) {
-      bool first = true;
-      File file = root.openNextFile();
-      while (file) {
-        String name = file.name();
-        if (name.endsWith(".fseq") || name.endsWith(".FSEQ")) {
-          if (!first)
-            json += ",";
-          first = false;
-          json += "{";
-          json += "\"name\":\"" + name + "\"";
-          json += "}";
-        }
-        file.close();
-        file = root.openNextFile();
-      }
-    }
-    root.close();
-    json += "]";
-    request->send(200, "application/json", json);
+    sendFileList(request, LIST_FSEQ);
   });
 
-  // API - File Upload
+  // API - File Upload (multipart form), see FSEQUpload for resuming
   server.on(
       "/api/sd/upload", HTTP_POST,
-      [](AsyncWebServerRequest *request) {
-        request->send(200, "text/plain", "Upload complete");
-      },
+      [](AsyncWebServerRequest *request) { sendUploadResult(request); },
       [](AsyncWebServerRequest *request, String filename, size_t index,
          uint8_t *data, size_t len, bool final) {
-        static File uploadFile;
-        if (index == 0) {
-          if (!filename.startsWith("/"))
-            filename = "/" + filename;
-          uploadFile = SD_ADAPTER.open(filename.c_str(), FILE_WRITE);
-        }
-        if (uploadFile) {
-          uploadFile.write(data, len);
-          if (final)
-            uploadFile.close();
+        receiveUpload(request, filename, index, data, len, final, 0);
+      });
+
+  // API - Upload progress, throughput and resume offset of a file
+  server.on(
+      "/api/sd/upload/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AsyncJsonResponse *response = new AsyncJsonResponse(384);
+        JsonObject root = response->getRoot();
+        root["state"] = FSEQUpload::getStateName();
+        root["file"] = FSEQUpload::getPath();
+        root["received"] = FSEQUpload::getReceived();
+        root["total"] = FSEQUpload::getTotal();
+        root["mbps"] = serialized(String(FSEQUpload::getThroughput(), 2));
+        root["error"] = FSEQUpload::getError();
+        if (request->hasArg("file")) {
+          String path = request->arg("file");
+          if (!path.startsWith("/"))
+            path = "/" + path;
+          root["partial"] = FSEQUpload::partialSize(path);
         }
+        response->setLength();
+        request->send(response);
       });
 
   // API - File Delete
@@ -305,57 +551,179 @@ void WebUIManager::registerEndpoints() {
     if (!path.startsWith("/"))
       path = "/" + path;
     bool res = SD_ADAPTER.remove(path.c_str());
+    if (res)
+      FSEQIndex::invalidate();
     request->send(200, "text/plain", res ? "File deleted" : "Delete failed");
   });
 
   // API - Start FSEQ (normal playback)
   server.on("/api/fseq/start", HTTP_GET, [](AsyncWebServerRequest *request) {
-    if (!request->hasArg("file")) {
-      request->send(400, "text/plain", "Missing file param");
+    FSEQCommand cmd = {};
+    if (!commandFile(request, cmd))
       return;
-    }
-    String filepath = request->arg("file");
-    if (!filepath.startsWith("/"))
-      filepath = "/" + filepath;
-    FSEQPlayer::loadRecording(filepath.c_str(), 0, uint16_t(-1), 0.0f);
-    request->send(200, "text/plain", "FSEQ started");
+    cmd.action = FSEQCommand::PLAY;
+    cmd.stopLed = uint16_t(-1);
+    cmd.repeats = RECORDING_REPEAT_DEFAULT;
+    queueCommand(request, cmd, "FSEQ start queued");
   });
 
   // API - Start FSEQ in loop mode
   server.on(
       "/api/fseq/startloop", HTTP_GET, [](AsyncWebServerRequest *request) {
-        if (!request->hasArg("file")) {
-          request->send(400, "text/plain", "Missing file param");
+        FSEQCommand cmd = {};
+        if (!commandFile(request, cmd))
           return;
-        }
-        String filepath = request->arg("file");
-        if (!filepath.startsWith("/"))
-          filepath = "/" + filepath;
-        // Passing 1.0f enables loop mode in loadRecording()
-        FSEQPlayer::loadRecording(filepath.c_str(), 0, uint16_t(-1), 1.0f);
-        request->send(200, "text/plain", "FSEQ loop started");
+        cmd.action = FSEQCommand::PLAY;
+        cmd.stopLed = uint16_t(-1);
+        cmd.repeats = RECORDING_REPEAT_LOOP;
+        queueCommand(request, cmd, "FSEQ loop queued");
       });
 
   // API - Stop FSEQ
   server.on("/api/fseq/stop", HTTP_GET, [](AsyncWebServerRequest *request) {
-    FSEQPlayer::clearLastPlayback();
-    if (realtimeOverride == REALTIME_OVERRIDE_ONCE)
-      realtimeOverride = REALTIME_OVERRIDE_NONE;
-    if (realtimeMode)
-      exitRealtime();
-    else {
-      realtimeMode = REALTIME_MODE_INACTIVE;
-      strip.trigger();
-    }
-    request->send(200, "text/plain", "FSEQ stopped");
+    FSEQCommand cmd = {};
+    cmd.action = FSEQCommand::STOP;
+    queueCommand(request, cmd, "FSEQ stop queued");
   });
 
-  // API - FSEQ Status
+  // API - Start a playlist file from the SD card
+  server.on(
+      "/api/fseq/playlist/start", HTTP_GET,
+      [](AsyncWebServerRequest *request) {
+        FSEQCommand cmd = {};
+        if (!commandFile(request, cmd))
+          return;
+        cmd.action = FSEQCommand::PLAYLIST;
+        queueCommand(request, cmd, "Playlist start queued");
+      });
+
+  // API - Stop the playlist and its playback
+  server.on(
+      "/api/fseq/playlist/stop", HTTP_GET, [](AsyncWebServerRequest *request) {
+        FSEQCommand cmd = {};
+        cmd.action = FSEQCommand::STOP;
+        queueCommand(request, cmd, "Playlist stop queued");
+      });
+
+  // API - Play a sequence on a segment next to the main playback
+  server.on(
+      "/api/fseq/segment/start", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (!request->hasArg("seg")) {
+          request->send(400, "text/plain", "Missing seg param");
+          return;
+        }
+        FSEQCommand cmd = {};
+        if (!commandFile(request, cmd))
+          return;
+        cmd.segment = request->arg("seg").toInt();
+        if (cmd.segment >= strip.getSegmentsNum()) {
+          request->send(409, "text/plain", "Cannot play on this segment");
+          return;
+        }
+        cmd.action = FSEQCommand::SEGMENT_PLAY;
+        cmd.repeats = request->arg("loop") == "1" ? RECORDING_REPEAT_LOOP
+                                                  : RECORDING_REPEAT_DEFAULT;
+        if (request->hasArg("start") && request->arg("start").toInt() > 0)
+          cmd.channelStart = request->arg("start").toInt() - 1;
+        queueCommand(request, cmd, "FSEQ start queued on segment");
+      });
+
+  server.on(
+      "/api/fseq/segment/stop", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (!request->hasArg("seg")) {
+          request->send(400, "text/plain", "Missing seg param");
+          return;
+        }
+        FSEQCommand cmd = {};
+        cmd.action = FSEQCommand::SEGMENT_STOP;
+        cmd.segment = request->arg("seg").toInt();
+        queueCommand(request, cmd, "FSEQ stop queued on segment");
+      });
+
+  // API - Record realtime data (DDP, E1.31, UDP) to a sequence file
+  server.on(
+      "/api/fseq/record/start", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (!request->hasArg("file")) {
+          request->send(400, "text/plain", "Missing file param");
+          return;
+        }
+        uint8_t step = 0;
+        if (request->hasArg("step"))
+          step = constrain(request->arg("step").toInt(), 0, 255);
+        if (!FSEQRecorder::start(request->arg("file"), step)) {
+          request->send(409, "text/plain", "Cannot record now");
+          return;
+        }
+        request->send(200, "text/plain", "Recording armed");
+      });
+
+  server.on(
+      "/api/fseq/record/stop", HTTP_GET, [](AsyncWebServerRequest *request) {
+        FSEQRecorder::stop();
+        request->send(200, "text/plain", "Recording stopped");
+      });
+
+  // API - FSEQ Status (names come from the card, so they are escaped by
+  // ArduinoJson)
   server.on("/api/fseq/status", HTTP_GET, [](AsyncWebServerRequest *request) {
-    bool playing = FSEQPlayer::isPlaying();
-    String json = "{\"playing\":";
-    json += (playing ? "true" : "false");
-    json += "}";
-    request->send(200, "application/json", json);
+    AsyncJsonResponse *response =
+        new AsyncJsonResponse(1536 + 192 * FSEQ_MAX_PLAYERS);
+    JsonObject root = response->getRoot();
+    FSEQPlayer &player = FSEQPlayer::primary();
+    bool playing = player.isPlaying();
+    root["playing"] = playing;
+    if (playing) {
+      FSEQIndex::Entry e;
+      root["file"] = player.getFileName();
+      root["storage"] = player.getStorageName();
+      root["elapsed"] = serialized(String(player.getElapsedSeconds(), 2));
+      if (FSEQIndex::find(player.getFileName().c_str(), e))
+        root["duration"] = serialized(String(e.durationMs() / 1000.0f, 2));
+    }
+    JsonObject index = root.createNestedObject("index");
+    index["files"] = FSEQIndex::getCount();
+    index["scanning"] = FSEQIndex::isScanning();
+    JsonObject prefetch = root.createNestedObject("prefetch");
+    prefetch["depth"] = player.getPrefetchDepth();
+    prefetch["filled"] = player.getPrefetchFill();
+    prefetch["underruns"] = player.getBufferUnderruns();
+    prefetch["frames"] = player.getFramesPlayed();
+    prefetch["blended"] = player.getFramesBlended();
+    JsonObject timing = root.createNestedObject("timing");
+    timing["drift"] = player.getSyncDrift();
+    timing["jitter"] = serialized(String(player.getFrameJitter(), 2));
+    timing["maxJitter"] = player.getMaxFrameJitter();
+    timing["dropped"] = player.getFramesDropped();
+    timing["jumps"] = player.getSyncJumps();
+    JsonObject seek = root.createNestedObject("seek");
+    seek["count"] = player.getSeekCount();
+    seek["lastMs"] = player.getLastSeekMs();
+    seek["maxMs"] = player.getMaxSeekMs();
+    JsonArray segments = root.createNestedArray("segments");
+    for (uint8_t i = 1; i < FSEQ_MAX_PLAYERS; i++) {
+      FSEQPlayer *p = FSEQPlayer::getPlayer(i);
+      if (!p->isPlaying())
+        continue;
+      JsonObject s = segments.createNestedObject();
+      s["seg"] = p->getSegment();
+      s["file"] = p->getFileName();
+      s["elapsed"] = serialized(String(p->getElapsedSeconds(), 2));
+      s["frames"] = p->getFramesPlayed();
+      s["underruns"] = p->getBufferUnderruns();
+    }
+    JsonObject record = root.createNestedObject("record");
+    record["state"] = FSEQRecorder::getStateName();
+    record["file"] = FSEQRecorder::getPath();
+    record["frames"] = FSEQRecorder::getFrames();
+    record["channels"] = FSEQRecorder::getChannels();
+    record["step"] = FSEQRecorder::getStepTime();
+    JsonObject playlist = root.createNestedObject("playlist");
+    playlist["active"] = FSEQPlaylist::isActive();
+    playlist["name"] = FSEQPlaylist::getName();
+    playlist["index"] = FSEQPlaylist::getIndex();
+    playlist["count"] = FSEQPlaylist::getCount();
+    playlist["queued"] = FSEQPlayer::primary().hasQueuedNext();
+    response->setLength();
+    request->send(response);
   });
 }
\ No newline at end of file
@@ -2,12 +2,96 @@
 #define WEB_UI_MANAGER_H
 
 #include "wled.h"
+#include <atomic>
 
+// number of playback requests buffered between the web server task and
+// loop(), power of 2
+#ifndef FSEQ_COMMAND_QUEUE_SIZE
+#define FSEQ_COMMAND_QUEUE_SIZE 8
+#endif
+
+// Playback request checked in the AsyncTCP task and applied in loop(), so the
+// players are only touched next to handlePlayers(): loading or stopping a
+// sequence frees buffers that loop() may be reading into.
+struct FSEQCommand {
+  enum Action : uint8_t {
+    PLAY,         // main playback, stops the playlist
+    STOP,         // playlist and main playback
+    SEGMENT_PLAY, // player of a segment
+    SEGMENT_STOP,
+    PLAYLIST      // playlist file from the SD card
+  };
+  uint8_t action;
+  uint8_t segment;       // SEGMENT_*
+  uint16_t stopLed;      // PLAY: end of the LED range, -1 = main segment
+  int32_t repeats;       // RECORDING_REPEAT_*
+  uint32_t channelStart; // SEGMENT_PLAY
+  char filepath[128];
+};
+
+// Lock-free single producer (AsyncTCP task) / single consumer (loop) ring,
+// like FPPCommandQueue. A full queue refuses the request.
+class FSEQCommandQueue {
+public:
+  bool push(const FSEQCommand &cmd) {
+    uint8_t head = _head.load(std::memory_order_relaxed);
+    uint8_t next = (head + 1) & (FSEQ_COMMAND_QUEUE_SIZE - 1);
+    if (next == _tail.load(std::memory_order_acquire))
+      return false;
+    _items[head] = cmd;
+    _head.store(next, std::memory_order_release);
+    return true;
+  }
+  bool pop(FSEQCommand &cmd) {
+    uint8_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+      return false;
+    cmd = _items[tail];
+    _tail.store((tail + 1) & (FSEQ_COMMAND_QUEUE_SIZE - 1),
+                std::memory_order_release);
+    return true;
+  }
+
+private:
+  FSEQCommand _items[FSEQ_COMMAND_QUEUE_SIZE];
+  std::atomic<uint8_t> _head{0}; // written by the producer
+  std::atomic<uint8_t> _tail{0}; // written by the consumer
+};
 
 class WebUIManager {
   public:
+    // formats of the streamed file listings
+    enum ListFormat : uint8_t {
+      LIST_SD,   // [{"name","size" in KB}]
+      LIST_FSEQ, // [{"name","size",header data}]
+      LIST_FPP   // {"files":[{"name","size"}]}
+    };
+
     WebUIManager() {}
     void registerEndpoints();
+    static void sendFileList(AsyncWebServerRequest *request, uint8_t format);
+    // upload body handler, bodyLength 0 = size of the body not known
+    static void receiveUpload(AsyncWebServerRequest *request,
+                              const String &filename, size_t index,
+                              const uint8_t *data, size_t len, bool final,
+                              uint32_t bodyLength);
+    static void sendUploadResult(AsyncWebServerRequest *request);
+    // file argument of a request as absolute path in cmd, answers 400 and
+    // returns false if it is missing or too long
+    static bool commandFile(AsyncWebServerRequest *request, FSEQCommand &cmd);
+    // hand a command to loop(), answers 202 with message or 503 if the queue
+    // is full; only called from web server handlers
+    static void queueCommand(AsyncWebServerRequest *request,
+                             const FSEQCommand &cmd, const String &message);
+    // called from the usermod loop before FSEQPlayer::handlePlayers(): starts
+    // and stops the players as requested through the web API
+    static void handleCommands();
+
+  private:
+    static bool beginUpload(AsyncWebServerRequest *request,
+                            const String &filename, uint32_t bodyLength);
+    static AsyncWebServerRequest *uploadRequest;
+    static FSEQCommandQueue commandQueue;
 };
 
 #endif // WEB_UI_MANAGER_H
\ No newline at end of file
@@ -21,6 +21,11 @@
 
 #include "const.h"
 #include "bus_manager.h"
+#ifdef WLED_ENABLE_PARALLEL_FX
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#endif
 
 #define FASTLED_INTERNAL //remove annoying pragma messages
 #define USE_GET_MILLISECOND_TIMER
@@ -49,6 +54,7 @@
 
 extern bool realtimeRespectLedMaps; // used in getMappedPixelIndex()
 extern byte realtimeMode;           // used in getMappedPixelIndex()
+extern uint8_t blendingStyle;       // used in isBufferDirect()
 
 /* Not used in all effects yet */
 #define WLED_FPS         42
@@ -86,6 +92,16 @@ extern byte realtimeMode;           // used in getMappedPixelIndex()
   #define MAX_SEGMENT_DATA  (MAX_NUM_SEGMENTS*1280) // 40k by default
 #endif
 
+/* How many segments may draw their old effect into a transition buffer at the same time, further
+  segments switch effects directly (colors, palette and brightness still transition) */
+#ifndef WLED_MAX_TRANSITION_BUFFERS
+  #ifdef ESP8266
+    #define WLED_MAX_TRANSITION_BUFFERS 2
+  #else
+    #define WLED_MAX_TRANSITION_BUFFERS 4
+  #endif
+#endif
+
 /* How much data bytes each segment should max allocate to leave enough space for other segments,
   assuming each segment uses the same amount of data. 256 for ESP8266, 640 for ESP32. */
 #define FAIR_DATA_PER_SEG (MAX_SEGMENT_DATA / strip.getMaxSegments())
@@ -376,6 +392,13 @@ extern byte realtimeMode;           // used in getMappedPixelIndex()
 #define BLEND_STYLE_PUSH_MASK       0x10
 #define BLEND_STYLE_COUNT           18
 
+// how a segment is composited onto the segments below it (segment opacity applies to all modes)
+#define BLEND_MODE_NORMAL           0x00  // alpha blend
+#define BLEND_MODE_ADD              0x01
+#define BLEND_MODE_MULTIPLY         0x02
+#define BLEND_MODE_SCREEN           0x03
+#define BLEND_MODE_COUNT            4
+
 
 typedef enum mapping1D2D {
   M12_Pixels = 0,
@@ -425,7 +448,8 @@ typedef struct Segment {
     };
     uint8_t startY;  // start Y coodrinate 2D (top); there should be no more than 255 rows
     uint8_t stopY;   // stop Y coordinate 2D (bottom); there should be no more than 255 rows
-    // note: two bytes of padding are added here
+    uint8_t blendMode; // how segment is composited onto segments below it (BLEND_MODE_*)
+    // note: one byte of padding is added here
     char    *name;
 
     // runtime data
@@ -435,6 +459,7 @@ typedef struct Segment {
     uint16_t aux0;  // custom var
     uint16_t aux1;  // custom var
     byte     *data; // effect data pointer
+    uint32_t *pixels; // virtual pixels of the segment (vWidth*vHeight in 2D, vLength in 1D), mapped to the LEDs in WS2812FX::show()
     static uint16_t maxWidth, maxHeight;  // these define matrix width & height (max. segment dimensions)
 
     typedef struct TemporarySegmentData {
@@ -455,9 +480,11 @@ typedef struct Segment {
       uint32_t _callT;
       uint8_t *_dataT;
       unsigned _dataLenT;
+      uint32_t *_pixelsT;
       TemporarySegmentData()
         : _dataT(nullptr) // just in case...
         , _dataLenT(0)
+        , _pixelsT(nullptr)
       {}
     } tmpsegd_t;
 
@@ -474,29 +501,34 @@ typedef struct Segment {
     };
     uint8_t         _default_palette;  // palette number that gets assigned to pal0
     unsigned        _dataLen;
+    unsigned        _pixelsLen;
+    uint32_t       *_pixelMap;    // cached flush() mapping, per LED: frame index (low 16 bits) and pixel buffer index (high 16 bits)
+    unsigned        _pixelMapLen;
+    uint32_t        _pixelMapKey; // offset and mapping options the cache was built with
     static unsigned _usedSegmentData;
-    static uint8_t  _segBri;                  // brightness of segment for current effect
-    static unsigned _vLength;                 // 1D dimension used for current effect
-    static unsigned _vWidth, _vHeight;        // 2D dimensions used for current effect
-    static uint32_t _currentColors[NUM_COLORS]; // colors used for current effect
-    static bool     _colorScaled;             // color has been scaled prior to setPixelColor() call
-    static CRGBPalette16 _currentPalette;     // palette used for current effect (includes transition, used in color_from_palette())
+    static uint32_t *_mapRecord;  // buildPixelMap() records the mapping here instead of drawing
+    static unsigned _mapRecordLen, _mapRecordCap;
+    static WLED_DRAW_STATE uint8_t  _segBri;  // brightness of segment for current effect
+    static WLED_DRAW_STATE unsigned _vLength; // 1D dimension used for current effect
+    static WLED_DRAW_STATE unsigned _vWidth, _vHeight; // 2D dimensions used for current effect
+    static WLED_DRAW_STATE uint32_t _currentColors[NUM_COLORS]; // colors used for current effect
+    static WLED_DRAW_STATE CRGBPalette16 _currentPalette; // palette used for current effect (includes transition, used in color_from_palette())
     static CRGBPalette16 _randomPalette;      // actual random palette
     static CRGBPalette16 _newRandomPalette;   // target random palette
     static uint16_t _lastPaletteChange;       // last random palette change time in millis()/1000
     static uint16_t _lastPaletteBlend;        // blend palette according to set Transition Delay in millis()%0xFFFF
-    static uint16_t _transitionprogress;      // current transition progress 0 - 0xFFFF
+    static WLED_DRAW_STATE uint16_t _transitionprogress; // current transition progress 0 - 0xFFFF
     #ifndef WLED_DISABLE_MODE_BLEND
-    static bool          _modeBlend;          // mode/effect blending semaphore
+    static WLED_DRAW_STATE bool     _modeBlend; // mode/effect blending semaphore
     // clipping
-    static uint16_t _clipStart, _clipStop;
-    static uint8_t  _clipStartY, _clipStopY;
+    static WLED_DRAW_STATE uint16_t _clipStart, _clipStop;
+    static WLED_DRAW_STATE uint8_t  _clipStartY, _clipStopY;
     #endif
 
     // transition data, valid only if transitional==true, holds values during transition (72 bytes)
     struct Transition {
       #ifndef WLED_DISABLE_MODE_BLEND
-      tmpsegd_t     _segT;        // previous segment environment
+      tmpsegd_t     _segT;        // previous segment environment (old effect draws into _segT._pixelsT)
       uint8_t       _modeT;       // previous mode/effect
       #else
       uint32_t      _colorT[NUM_COLORS];
@@ -508,16 +540,35 @@ typedef struct Segment {
       uint8_t       _prevPaletteBlends; // number of previous palette blends (there are max 255 blends possible)
       unsigned long _start;       // must accommodate millis()
       uint16_t      _dur;
-      // -> here is one byte of padding
+      uint16_t      _progress;    // progress the last frame was drawn with (used to blend it in WS2812FX::show())
       Transition(uint16_t dur=750)
         : _palT(CRGBPalette16(CRGB::Black))
         , _prevPaletteBlends(0)
         , _start(millis())
         , _dur(dur)
+        , _progress(0)
       {}
     } *_t;
 
     [[gnu::hot]] void _setPixelColorXY_raw(const int& x, const int& y, uint32_t& col) const; // set pixel without mapping (internal use only)
+    [[gnu::hot]] void mapPixel(int i, uint32_t col) const;                       // writes virtual pixel to LEDs (1D)
+    [[gnu::hot]] void mapPixelXY(int x, int y, uint32_t col, int vW, int vH) const; // writes virtual pixel to LEDs (2D)
+    [[gnu::hot]] void outputPixel(unsigned i, uint32_t col) const;               // writes mapped pixel into strip frame (or records mapping)
+    void mapPixels(const uint32_t *px) const;                                    // maps all pixels of px (their indices if nullptr)
+    bool buildPixelMap();                                                        // (re)builds cached mapping if needed
+    // pixels can be processed directly in the buffer (no clipping or shifting by a transition)
+    inline bool isBufferDirect() const {
+      #ifndef WLED_DISABLE_MODE_BLEND
+      if (isInTransition() && blendingStyle != BLEND_STYLE_FADE) return false;
+      #endif
+      return pixels && _pixelsLen == (is2D() ? vWidth() * vHeight() : vLength());
+    }
+    static void blurPixels(uint32_t *px, unsigned len, unsigned stride, uint8_t keep, uint8_t seep); // blurs row/column of pixel buffer
+    #ifndef WLED_DISABLE_MODE_BLEND
+    static uint32_t *getTransitionBuffer(unsigned len); // takes a buffer of at least len pixels from the pool (nullptr if none is left)
+    static void releaseTransitionBuffer(uint32_t *px);  // returns buffer to the pool
+    void flushTransition() const;                       // flush() while the old effect draws into a transition buffer
+    #endif
 
   public:
 
@@ -543,6 +594,7 @@ typedef struct Segment {
       check3(false),
       startY(0),
       stopY(1),
+      blendMode(BLEND_MODE_NORMAL),
       name(nullptr),
       next_time(0),
       step(0),
@@ -550,9 +602,14 @@ typedef struct Segment {
       aux0(0),
       aux1(0),
       data(nullptr),
+      pixels(nullptr),
       _capabilities(0),
       _default_palette(0),
       _dataLen(0),
+      _pixelsLen(0),
+      _pixelMap(nullptr),
+      _pixelMapLen(0),
+      _pixelMapKey(0),
       _t(nullptr)
     {
       #ifdef WLED_DEBUG
@@ -578,18 +635,23 @@ typedef struct Segment {
       if (name) { free(name); name = nullptr; }
       stopTransition();
       deallocateData();
+      deallocatePixels();
+      invalidatePixelMap();
     }
 
     Segment& operator= (const Segment &orig); // copy assignment
     Segment& operator= (Segment &&orig) noexcept; // move assignment
 
 #ifdef WLED_DEBUG
-    size_t getSize() const { return sizeof(Segment) + (data?_dataLen:0) + (name?strlen(name):0) + (_t?sizeof(Transition):0); }
+    size_t getSize() const { return sizeof(Segment) + (data?_dataLen:0) + (pixels?_pixelsLen*sizeof(uint32_t):0) + _pixelMapLen*sizeof(uint32_t) + (name?strlen(name):0) + (_t?sizeof(Transition):0); }
 #endif
 
     inline bool     getOption(uint8_t n) const { return ((options >> n) & 0x01); }
     inline bool     isSelected()         const { return selected; }
     inline bool     isInTransition()     const { return _t != nullptr; }
+    #ifndef WLED_DISABLE_MODE_BLEND
+    inline bool     hasTransitionBuffer() const { return _t && _t->_segT._pixelsT; } // old effect is drawn into its own buffer
+    #endif
     inline bool     isActive()           const { return stop > start; }
     inline bool     hasRGB()             const { return _isRGB; }
     inline bool     hasWhite()           const { return _hasW; }
@@ -633,6 +695,10 @@ typedef struct Segment {
     inline uint16_t dataSize() const { return _dataLen; }
     bool allocateData(size_t len);  // allocates effect data buffer in heap and clears it
     void deallocateData();          // deallocates (frees) effect data buffer from heap
+    bool allocatePixels();          // (re)allocates pixel buffer if segment dimensions changed
+    void deallocatePixels();        // deallocates (frees) pixel buffer from heap
+    void flush();                   // maps pixel buffer into the strip frame (applies reverse, mirror, grouping and spacing)
+    inline void invalidatePixelMap() { free(_pixelMap); _pixelMap = nullptr; _pixelMapLen = 0; } // mapping is rebuilt in next flush()
     void resetIfRequired();         // sets all SEGENV variables to 0 and clears data buffer
     /**
       * Flags that before the next effect is calculated,
@@ -646,6 +712,8 @@ typedef struct Segment {
     void     startTransition(uint16_t dur);     // transition has to start before actual segment values change
     void     stopTransition();                  // ends transition mode by destroying transition structure (does nothing if not in transition)
     inline void handleTransition() { updateTransitionProgress(); if (progress() == 0xFFFFU) stopTransition(); }
+    inline void restoreTransitionProgress() { _transitionprogress = isInTransition() ? _t->_progress : 0xFFFFU; } // progress the last frame was drawn with
+    static void handleTransitionBuffers();      // frees transition buffers that were not used for a while
     #ifndef WLED_DISABLE_MODE_BLEND
     void     swapSegenv(tmpsegd_t &tmpSegD);    // copies segment data into specifed buffer, if buffer is not a transition buffer, segment data is overwritten from transition buffer
     void     restoreSegenv(const tmpsegd_t &tmpSegD); // restores segment data from buffer, if buffer is not transition buffer, changed values are copied to transition buffer
@@ -671,6 +739,7 @@ typedef struct Segment {
     #endif
     #ifndef WLED_DISABLE_MODE_BLEND
     static inline void setClippingRect(int startX, int stopX, int startY = 0, int stopY = 1) { _clipStart = startX; _clipStop = stopX; _clipStartY = startY; _clipStopY = stopY; };
+    static void setTransitionClippingRect(unsigned w, unsigned h); // new effect is shown inside and old effect outside of it (blending style)
     #endif
     bool isPixelClipped(int i) const;
     [[gnu::hot]] uint32_t getPixelColor(int i) const;
@@ -830,9 +899,21 @@ class WS2812FX {  // 96 bytes
       _callback(nullptr),
       customMappingTable(nullptr),
       customMappingSize(0),
+      _pixels(nullptr),
+      _pixelCCT(nullptr),
+      _pixelsLen(0),
+      _layerBlend(BLEND_MODE_NORMAL),
+      _layerOpacity(255),
+      _layerCCT(127),
       _lastShow(0),
       _lastServiceShow(0),
-      _segment_index(0),
+#ifdef WLED_ENABLE_PARALLEL_FX
+      _renderTask(nullptr),
+      _renderDone(nullptr),
+      _renderJobCount(0),
+      _renderNext(0),
+      _renderNow(0),
+#endif
       _mainSegment(0)
     {
       WS2812FX::instance = this;
@@ -844,6 +925,8 @@ class WS2812FX {  // 96 bytes
 
     ~WS2812FX() {
       if (customMappingTable) free(customMappingTable);
+      free(_pixels);
+      free(_pixelCCT);
       _mode.clear();
       _modeData.clear();
       _segments.clear();
@@ -870,6 +953,7 @@ class WS2812FX {  // 96 bytes
       makeAutoSegments(bool forceReset = false),  // will create segments based on configured outputs
       fixInvalidSegments(),                       // fixes incorrect segment configuration
       setPixelColor(unsigned i, uint32_t c) const,      // paints absolute strip pixel with index n and color c
+      setPixelsRGB(unsigned i, const uint8_t *data, unsigned count, bool rgbw = false) const, // paints count strip pixels starting at i from packed RGB(W) data
       show(),                                     // initiates LED output
       setTargetFps(unsigned fps),
       setupEffectData();                          // add default effects to the list; defined in FX.cpp
@@ -1029,11 +1113,36 @@ class WS2812FX {  // 96 bytes
     uint16_t* customMappingTable;
     uint16_t  customMappingSize;
 
+    // frame the segments are composited into by show(), in logical LED order (before ledmap)
+    uint32_t* _pixels;
+    uint8_t*  _pixelCCT;  // CCT of each pixel, only allocated if segments may differ in CCT
+    uint16_t  _pixelsLen;
+    uint8_t   _layerBlend;   // blend mode, opacity and CCT of the segment being composited
+    uint8_t   _layerOpacity;
+    uint8_t   _layerCCT;
+
     unsigned long _lastShow;
     unsigned long _lastServiceShow;
 
-    uint8_t _segment_index;
+    static WLED_DRAW_STATE uint8_t _segment_index; // segment being drawn
     uint8_t _mainSegment;
+
+    void renderSegment(Segment &seg, unsigned long nowUp); // runs the effect of a segment that is due
+    bool allocateFrame(bool withCCT);                      // (re)allocates composited frame if strip length changed
+    [[gnu::hot]] void compositePixel(unsigned i, uint32_t c); // blends pixel of the segment being flushed into the frame
+#ifdef WLED_ENABLE_PARALLEL_FX
+    TaskHandle_t      _renderTask;  // renders segments on core 0 while the loop task renders on core 1
+    SemaphoreHandle_t _renderDone;
+    uint8_t           _renderJobs[MAX_NUM_SEGMENTS]; // segments that are rendered on both cores this frame
+    uint8_t           _renderJobCount;
+    std::atomic<unsigned> _renderNext; // next job, taken by whichever core is free
+    unsigned long     _renderNow;
+
+    bool canRenderParallel(unsigned id) const;
+    void renderParallel(unsigned long nowUp);
+    void renderJobs();
+    static void renderTask(void *arg);
+#endif
 };
 
 extern const char JSON_mode_names[];
@@ -21,6 +21,7 @@
 // so matrix should disable regular ledmap processing
 void WS2812FX::setUpMatrix() {
 #ifndef WLED_DISABLE_2D
+  for (segment &seg : _segments) seg.invalidatePixelMap(); // cached mappings depend on Segment::maxWidth
   // isMatrix is set in cfg.cpp or set.cpp
   if (isMatrix) {
     // calculate width dynamically because it may have gaps
@@ -150,19 +151,19 @@ void IRAM_ATTR_YN Segment::_setPixelColorXY_raw(const int& x, const int& y, uint
 {
   const int baseX = start + x;
   const int baseY = startY + y;
-#ifndef WLED_DISABLE_MODE_BLEND
-  // if blending modes, blend with underlying pixel
-  if (_modeBlend && blendingStyle == BLEND_STYLE_FADE) col = color_blend16(strip.getPixelColorXY(baseX, baseY), col, 0xFFFFU - progress());
-#endif
-  strip.setPixelColorXY(baseX, baseY, col);
+  const unsigned base = baseY * Segment::maxWidth + baseX;
+  outputPixel(base, col);
 
-  // Apply mirroring
+  // Apply mirroring, pixels in the middle row/column are composited only once
   if (mirror || mirror_y) {
     const int mirrorX = start + width() - x - 1;
     const int mirrorY = startY + height() - y - 1;
-    if (mirror) strip.setPixelColorXY(transpose ? baseX : mirrorX, transpose ? mirrorY : baseY, col);
-    if (mirror_y) strip.setPixelColorXY(transpose ? mirrorX : baseX, transpose ? baseY : mirrorY, col);
-    if (mirror && mirror_y) strip.setPixelColorXY(mirrorX, mirrorY, col);
+    const unsigned mX = mirror   ? (transpose ? mirrorY * Segment::maxWidth + baseX : baseY * Segment::maxWidth + mirrorX) : base;
+    const unsigned mY = mirror_y ? (transpose ? baseY * Segment::maxWidth + mirrorX : mirrorY * Segment::maxWidth + baseX) : base;
+    const unsigned mXY = mirrorY * Segment::maxWidth + mirrorX;
+    if (mX != base) outputPixel(mX, col);
+    if (mY != base && mY != mX) outputPixel(mY, col);
+    if (mirror && mirror_y && mXY != base && mXY != mX && mXY != mY) outputPixel(mXY, col);
   }
 }
 
@@ -185,7 +186,7 @@ bool IRAM_ATTR_YN Segment::isPixelXYClipped(int x, int y) const {
       if (len < 2) return false;
       const unsigned shuffled = hashInt(x + y * width) % len;
       const unsigned pos = (shuffled * 0xFFFFU) / len;
-      return progress() > pos;
+      return (progress() <= pos) ^ _modeBlend;
     }
     bool xInside = (x >= startX && x < stopX); if (invertX) xInside = !xInside;
     bool yInside = (y >= startY && y < stopY); if (invertY) yInside = !yInside;
@@ -217,10 +218,14 @@ void IRAM_ATTR_YN Segment::setPixelColorXY(int x, int y, uint32_t col) const
 #endif
 
   if (x >= vW || y >= vH || x < 0 || y < 0 || isPixelXYClipped(x,y)) return;  // if pixel would fall out of virtual segment just exit
+  const unsigned i = x + y * vW;
+  if (i >= _pixelsLen) return; // no pixel buffer (yet)
+  pixels[i] = col; // during transition old effect draws into its own buffer (see swapSegenv())
+}
 
-  // if color is unscaled
-  if (!_colorScaled) col = color_fade(col, _segBri);
-
+// writes virtual pixel of a 2D segment to the LEDs
+void IRAM_ATTR_YN Segment::mapPixelXY(int x, int y, uint32_t col, int vW, int vH) const
+{
   if (reverse  ) x = vW - x - 1;
   if (reverse_y) y = vH - y - 1;
   if (transpose) { std::swap(x,y); } // swap X & Y if segment transposed
@@ -306,14 +311,8 @@ uint32_t IRAM_ATTR_YN Segment::getPixelColorXY(int x, int y) const {
 #endif
 
   if (x >= vW || y >= vH || x<0 || y<0 || isPixelXYClipped(x,y)) return 0;  // if pixel would fall out of virtual segment just exit
-
-  if (reverse  ) x = vW - x - 1;
-  if (reverse_y) y = vH - y - 1;
-  if (transpose) { std::swap(x,y); } // swap X & Y if segment transposed
-  x *= groupLength(); // expand to physical pixels
-  y *= groupLength(); // expand to physical pixels
-  if (x >= width() || y >= height()) return 0;
-  return strip.getPixelColorXY(start + x, startY + y);
+  const unsigned i = x + y * vW;
+  return i < _pixelsLen ? pixels[i] : 0;
 }
 
 // 2D blurring, can be asymmetrical
@@ -321,12 +320,17 @@ void Segment::blur2D(uint8_t blur_x, uint8_t blur_y, bool smear) {
   if (!isActive()) return; // not active
   const unsigned cols = vWidth();
   const unsigned rows = vHeight();
+  const bool direct = isBufferDirect(); // blur in pixel buffer
   uint32_t lastnew;   // not necessary to initialize lastnew and last, as both will be initialized by the first loop iteration
   uint32_t last;
   if (blur_x) {
     const uint8_t keepx = smear ? 255 : 255 - blur_x;
     const uint8_t seepx = blur_x >> 1;
     for (unsigned row = 0; row < rows; row++) { // blur rows (x direction)
+      if (direct) {
+        blurPixels(pixels + row * cols, cols, 1, keepx, seepx);
+        continue;
+      }
       uint32_t carryover = BLACK;
       uint32_t curnew = BLACK;
       for (unsigned x = 0; x < cols; x++) {
@@ -350,6 +354,10 @@ void Segment::blur2D(uint8_t blur_x, uint8_t blur_y, bool smear) {
     const uint8_t keepy = smear ? 255 : 255 - blur_y;
     const uint8_t seepy = blur_y >> 1;
     for (unsigned col = 0; col < cols; col++) {
+      if (direct) {
+        blurPixels(pixels + col, rows, cols, keepy, seepy);
+        continue;
+      }
       uint32_t carryover = BLACK;
       uint32_t curnew = BLACK;
       for (unsigned y = 0; y < rows; y++) {
@@ -549,9 +557,6 @@ void Segment::drawCircle(uint16_t cx, uint16_t cy, uint8_t radius, uint32_t col,
       x++;
     }
   } else {
-    // pre-scale color for all pixels
-    col = color_fade(col, _segBri);
-    _colorScaled = true;
     // Bresenham’s Algorithm
     int d = 3 - (2*radius);
     int y = radius, x = 0;
@@ -570,7 +575,6 @@ void Segment::drawCircle(uint16_t cx, uint16_t cy, uint8_t radius, uint32_t col,
         d += 4 * x + 6;
       }
     }
-    _colorScaled = false;
   }
 }
 
@@ -581,9 +585,6 @@ void Segment::fillCircle(uint16_t cx, uint16_t cy, uint8_t radius, uint32_t col,
   const int vH = vHeight();  // segment height in logical pixels (is always >= 1)
   // draw soft bounding circle
   if (soft) drawCircle(cx, cy, radius, col, soft);
-  // pre-scale color for all pixels
-  col = color_fade(col, _segBri);
-  _colorScaled = true;
   // fill it
   for (int y = -radius; y <= radius; y++) {
     for (int x = -radius; x <= radius; x++) {
@@ -593,7 +594,6 @@ void Segment::fillCircle(uint16_t cx, uint16_t cy, uint8_t radius, uint32_t col,
         setPixelColorXY(cx + x, cy + y, col);
     }
   }
-  _colorScaled = false;
 }
 
 //line function
@@ -639,9 +639,6 @@ void Segment::drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint3
       if (steep) std::swap(x,y);  // restore if steep
     }
   } else {
-    // pre-scale color for all pixels
-    c = color_fade(c, _segBri);
-    _colorScaled = true;
     // Bresenham's algorithm
     int err = (dx>dy ? dx : -dy)/2;   // error direction
     for (;;) {
@@ -651,7 +648,6 @@ void Segment::drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint3
       if (e2 >-dx) { err -= dy; x0 += sx; }
       if (e2 < dy) { err += dx; y0 += sy; }
     }
-    _colorScaled = false;
   }
 }
 
@@ -685,9 +681,6 @@ void Segment::drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w,
       default: return;
     }
     uint32_t c = ColorFromPaletteWLED(grad, (i+1)*255/h, 255, NOBLEND);
-    // pre-scale color for all pixels
-    c = color_fade(c, _segBri);
-    _colorScaled = true;
     for (int j = 0; j<w; j++) { // character width
       int x0, y0;
       switch (rotate) {
@@ -702,7 +695,6 @@ void Segment::drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w,
         setPixelColorXY(x0, y0, c);
       }
     }
-    _colorScaled = false;
   }
 }
 
@@ -68,27 +68,38 @@ static constexpr bool validatePinsAndTypes(const unsigned* types, unsigned numTy
 // Segment class implementation
 ///////////////////////////////////////////////////////////////////////////////
 unsigned      Segment::_usedSegmentData   = 0U; // amount of RAM all segments use for their data[]
+uint32_t*     Segment::_mapRecord         = nullptr;
+unsigned      Segment::_mapRecordLen      = 0;
+unsigned      Segment::_mapRecordCap      = 0;
 uint16_t      Segment::maxWidth           = DEFAULT_LED_COUNT;
 uint16_t      Segment::maxHeight          = 1;
-unsigned      Segment::_vLength           = 0;
-unsigned      Segment::_vWidth            = 0;
-unsigned      Segment::_vHeight           = 0;
-uint8_t       Segment::_segBri            = 0;
-uint32_t      Segment::_currentColors[NUM_COLORS] = {0,0,0};
-bool          Segment::_colorScaled       = false;
-CRGBPalette16 Segment::_currentPalette    = CRGBPalette16(CRGB::Black);
+WLED_DRAW_STATE unsigned      Segment::_vLength        = 0;
+WLED_DRAW_STATE unsigned      Segment::_vWidth         = 0;
+WLED_DRAW_STATE unsigned      Segment::_vHeight        = 0;
+WLED_DRAW_STATE uint8_t       Segment::_segBri         = 0;
+WLED_DRAW_STATE uint32_t      Segment::_currentColors[NUM_COLORS] = {0,0,0};
+WLED_DRAW_STATE CRGBPalette16 Segment::_currentPalette = CRGBPalette16(CRGB::Black);
 CRGBPalette16 Segment::_randomPalette     = generateRandomPalette();  // was CRGBPalette16(DEFAULT_COLOR);
 CRGBPalette16 Segment::_newRandomPalette  = generateRandomPalette();  // was CRGBPalette16(DEFAULT_COLOR);
 uint16_t      Segment::_lastPaletteChange = 0; // perhaps it should be per segment
 uint16_t      Segment::_lastPaletteBlend  = 0; //in millis (lowest 16 bits only)
-uint16_t      Segment::_transitionprogress  = 0xFFFF;
+WLED_DRAW_STATE uint16_t Segment::_transitionprogress = 0xFFFF;
 
 #ifndef WLED_DISABLE_MODE_BLEND
-bool Segment::_modeBlend = false;
-uint16_t Segment::_clipStart = 0;
-uint16_t Segment::_clipStop = 0;
-uint8_t  Segment::_clipStartY = 0;
-uint8_t  Segment::_clipStopY = 1;
+WLED_DRAW_STATE bool     Segment::_modeBlend = false;
+WLED_DRAW_STATE uint16_t Segment::_clipStart = 0;
+WLED_DRAW_STATE uint16_t Segment::_clipStop = 0;
+WLED_DRAW_STATE uint8_t  Segment::_clipStartY = 0;
+WLED_DRAW_STATE uint8_t  Segment::_clipStopY = 1;
+
+// buffers the old effects draw into during transitions, kept for reuse until idle for TRANSITION_BUFFER_IDLE ms
+#define TRANSITION_BUFFER_IDLE 10000
+static struct {
+  uint32_t     *pixels;
+  unsigned      len;
+  unsigned long released; // millis() when it was returned to the pool
+  bool          inUse;
+} transitionBuffers[WLED_MAX_TRANSITION_BUFFERS];
 #endif
 
 // copy constructor
@@ -99,8 +110,14 @@ Segment::Segment(const Segment &orig) {
   name = nullptr;
   data = nullptr;
   _dataLen = 0;
+  pixels = nullptr;
+  _pixelsLen = 0;
+  _pixelMap = nullptr;
+  _pixelMapLen = 0;
   if (orig.name) { name = static_cast<char*>(malloc(strlen(orig.name)+1)); if (name) strcpy(name, orig.name); }
   if (orig.data) { if (allocateData(orig._dataLen)) memcpy(data, orig.data, orig._dataLen); }
+  // pixels are not copied: copies are mostly snapshots to compare settings against (json.cpp, led.cpp),
+  // a copy that gets drawn allocates its buffer in service() and the effect fills it
 }
 
 // move constructor
@@ -111,6 +128,10 @@ Segment::Segment(Segment &&orig) noexcept {
   orig.name = nullptr;
   orig.data = nullptr;
   orig._dataLen = 0;
+  orig.pixels = nullptr;
+  orig._pixelsLen = 0;
+  orig._pixelMap = nullptr;
+  orig._pixelMapLen = 0;
 }
 
 // copy assignment
@@ -121,14 +142,21 @@ Segment& Segment::operator= (const Segment &orig) {
     if (name) { free(name); name = nullptr; }
     stopTransition();
     deallocateData();
+    deallocatePixels();
+    invalidatePixelMap();
     // copy source
     memcpy((void*)this, (void*)&orig, sizeof(Segment));
     // erase pointers to allocated data
     data = nullptr;
     _dataLen = 0;
+    pixels = nullptr;
+    _pixelsLen = 0;
+    _pixelMap = nullptr;
+    _pixelMapLen = 0;
     // copy source data
     if (orig.name) { name = static_cast<char*>(malloc(strlen(orig.name)+1)); if (name) strcpy(name, orig.name); }
     if (orig.data) { if (allocateData(orig._dataLen)) memcpy(data, orig.data, orig._dataLen); }
+    if (orig.pixels && allocatePixels() && _pixelsLen == orig._pixelsLen) memcpy(pixels, orig.pixels, _pixelsLen * sizeof(uint32_t));
   }
   return *this;
 }
@@ -140,10 +168,16 @@ Segment& Segment::operator= (Segment &&orig) noexcept {
     if (name) { free(name); name = nullptr; } // free old name
     stopTransition();
     deallocateData(); // free old runtime data
+    deallocatePixels();
+    invalidatePixelMap();
     memcpy((void*)this, (void*)&orig, sizeof(Segment));
     orig.name = nullptr;
     orig.data = nullptr;
     orig._dataLen = 0;
+    orig.pixels = nullptr;
+    orig._pixelsLen = 0;
+    orig._pixelMap = nullptr;
+    orig._pixelMapLen = 0;
     orig._t   = nullptr; // old segment cannot be in transition
   }
   return *this;
@@ -187,6 +221,84 @@ void IRAM_ATTR_YN Segment::deallocateData() {
   _dataLen = 0;
 }
 
+// allocates pixel buffer for the virtual segment, an existing buffer of the right size is kept (with its content)
+bool Segment::allocatePixels() {
+  unsigned len = 0;
+  if (isActive()) len = is2D() ? virtualWidth() * virtualHeight() : virtualLength();
+  if (pixels && _pixelsLen == len) return true;
+  deallocatePixels();
+  invalidatePixelMap();
+  #ifndef WLED_DISABLE_MODE_BLEND
+  if (isInTransition() && _t->_segT._pixelsT) {
+    releaseTransitionBuffer(_t->_segT._pixelsT); // old effect would not fit, the rest of the transition only runs the new one
+    _t->_segT._pixelsT = nullptr;
+  }
+  #endif
+  if (len == 0) return false;
+  // do not use SPI RAM on ESP32 since it is slow
+  pixels = static_cast<uint32_t*>(calloc(len, sizeof(uint32_t)));
+  if (!pixels) {
+    DEBUG_PRINTF_P(PSTR("!!! Pixel buffer allocation failed (%u) !!!\n"), len);
+    errorFlag = ERR_NORAM;
+    return false;
+  }
+  _pixelsLen = len;
+  return true;
+}
+
+void Segment::deallocatePixels() {
+  free(pixels);
+  pixels = nullptr;
+  _pixelsLen = 0;
+}
+
+#ifndef WLED_DISABLE_MODE_BLEND
+// a free buffer that is large enough is preferred, otherwise a free one is (re)allocated
+// there are only WLED_MAX_TRANSITION_BUFFERS, which bounds the cost of concurrent transitions
+uint32_t *Segment::getTransitionBuffer(unsigned len) {
+  int slot = -1;
+  for (int n = 0; n < WLED_MAX_TRANSITION_BUFFERS; n++) {
+    if (transitionBuffers[n].inUse) continue;
+    if (transitionBuffers[n].pixels && transitionBuffers[n].len >= len) { slot = n; break; }
+    if (slot < 0) slot = n;
+  }
+  if (slot < 0 || len == 0) return nullptr;
+  auto &tb = transitionBuffers[slot];
+  if (!tb.pixels || tb.len < len) {
+    free(tb.pixels);
+    tb.len = 0;
+    // do not use SPI RAM on ESP32 since it is slow
+    tb.pixels = static_cast<uint32_t*>(malloc(len * sizeof(uint32_t)));
+    if (!tb.pixels) {
+      DEBUG_PRINTF_P(PSTR("!!! Transition buffer allocation failed (%u) !!!\n"), len);
+      return nullptr;
+    }
+    tb.len = len;
+  }
+  tb.inUse = true;
+  return tb.pixels;
+}
+
+void Segment::releaseTransitionBuffer(uint32_t *px) {
+  for (auto &tb : transitionBuffers) if (tb.inUse && tb.pixels == px) {
+    tb.inUse = false;
+    tb.released = millis();
+    return;
+  }
+}
+#endif
+
+// relies on WS2812FX::service() to call it for each frame
+void Segment::handleTransitionBuffers() {
+  #ifndef WLED_DISABLE_MODE_BLEND
+  for (auto &tb : transitionBuffers) if (tb.pixels && !tb.inUse && millis() - tb.released > TRANSITION_BUFFER_IDLE) {
+    free(tb.pixels);
+    tb.pixels = nullptr;
+    tb.len = 0;
+  }
+  #endif
+}
+
 /**
   * If reset of this segment was requested, clears runtime
   * settings of this segment.
@@ -282,6 +394,9 @@ void Segment::startTransition(uint16_t dur) {
       _t->_segT._dataLenT = _dataLen;
     }
   }
+  // old effect continues from the last frame in its own buffer (without one only the new effect is drawn)
+  _t->_segT._pixelsT = pixels ? getTransitionBuffer(_pixelsLen) : nullptr;
+  if (_t->_segT._pixelsT) memcpy(_t->_segT._pixelsT, pixels, _pixelsLen * sizeof(uint32_t));
 #else
   for (size_t i=0; i<NUM_COLORS; i++) _t->_colorT[i] = colors[i];
 #endif
@@ -297,6 +412,7 @@ void Segment::stopTransition() {
       _t->_segT._dataT = nullptr;
       _t->_segT._dataLenT = 0;
     }
+    if (_t->_segT._pixelsT) releaseTransitionBuffer(_t->_segT._pixelsT);
     #endif
     delete _t;
     _t = nullptr;
@@ -310,6 +426,7 @@ inline void Segment::updateTransitionProgress() {
   if (isInTransition()) {
     unsigned diff = millis() - _t->_start;
     if (_t->_dur > 0 && diff < _t->_dur) _transitionprogress = diff * 0xFFFFU / _t->_dur;
+    _t->_progress = _transitionprogress;
   }
 }
 
@@ -332,6 +449,7 @@ void Segment::swapSegenv(tmpsegd_t &tmpSeg) {
   tmpSeg._callT      = call;
   tmpSeg._dataT      = data;
   tmpSeg._dataLenT   = _dataLen;
+  tmpSeg._pixelsT    = pixels;
   if (isInTransition() && &tmpSeg != &(_t->_segT)) {
     // swap SEGENV with transitional data
     options   = _t->_segT._optionsT;
@@ -350,6 +468,7 @@ void Segment::swapSegenv(tmpsegd_t &tmpSeg) {
     call      = _t->_segT._callT;
     data      = _t->_segT._dataT;
     _dataLen  = _t->_segT._dataLenT;
+    pixels    = _t->_segT._pixelsT;
   }
 }
 
@@ -381,6 +500,7 @@ void Segment::restoreSegenv(const tmpsegd_t &tmpSeg) {
   call      = tmpSeg._callT;
   data      = tmpSeg._dataT;
   _dataLen  = tmpSeg._dataLenT;
+  pixels    = tmpSeg._pixelsT;
 }
 #endif
 
@@ -495,7 +615,7 @@ void Segment::handleRandomPalette() {
 
 // sets Segment geometry (length or width/height and grouping, spacing and offset as well as 2D mapping)
 // strip must be suspended (strip.suspend()) before calling this function
-// this function may call fill() to clear pixels if spacing or mapping changed (which requires setting _vWidth, _vHeight, _vLength or beginDraw())
+// this function clears the LEDs of the old geometry and resizes the pixel buffer
 void Segment::setGeometry(uint16_t i1, uint16_t i2, uint8_t grp, uint8_t spc, uint16_t ofs, uint16_t i1Y, uint16_t i2Y, uint8_t m12) {
   // return if neither bounds nor grouping have changed
   bool boundsUnchanged = (start == i1 && stop == i2);
@@ -509,14 +629,8 @@ void Segment::setGeometry(uint16_t i1, uint16_t i2, uint8_t grp, uint8_t spc, ui
      ) return;
 
   stateChanged = true; // send UDP/WS broadcast
+  invalidatePixelMap();
 
-  if (stop || spc != spacing || m12 != map1D2D) {
-    _vWidth  = virtualWidth();
-    _vHeight = virtualHeight();
-    _vLength = virtualLength();
-    _segBri  = currentBri();
-    fill(BLACK); // turn old segment range off or clears pixels if changing spacing (requires _vWidth/_vHeight/_vLength/_segBri)
-  }
   if (grp) { // prevent assignment of 0
     grouping = grp;
     spacing = spc;
@@ -532,11 +646,15 @@ void Segment::setGeometry(uint16_t i1, uint16_t i2, uint8_t grp, uint8_t spc, ui
   DEBUG_PRINT(F(" -> ")); DEBUG_PRINT(i1Y);
   DEBUG_PRINT(','); DEBUG_PRINTLN(i2Y);
   markForReset();
-  if (boundsUnchanged) return;
+  if (boundsUnchanged) {
+    allocatePixels(); // grouping, spacing or mapping changed
+    return;
+  }
 
   // apply change immediately
   if (i2 <= i1) { //disable segment
     stop = 0;
+    deallocatePixels();
     return;
   }
   if (i1 < Segment::maxWidth || (i1 >= Segment::maxWidth*Segment::maxHeight && i1 < strip.getLengthTotal())) start = i1; // Segment::maxWidth equals strip.getLengthTotal() for 1D
@@ -552,9 +670,11 @@ void Segment::setGeometry(uint16_t i1, uint16_t i2, uint8_t grp, uint8_t spc, ui
   // safety check
   if (start >= stop || startY >= stopY) {
     stop = 0;
+    deallocatePixels();
     return;
   }
   refreshLightCapabilities();
+  allocatePixels();
 }
 
 
@@ -754,6 +874,63 @@ uint16_t Segment::virtualLength() const {
   return vLength;
 }
 
+#ifndef WLED_DISABLE_MODE_BLEND
+// sets the clipping rectangle of a w*h segment for the blending style and current transition progress
+void Segment::setTransitionClippingRect(unsigned w, unsigned h) {
+  unsigned p = progress();
+  unsigned dw = p * w / 0xFFFFU + 1;
+  unsigned dh = p * h / 0xFFFFU + 1;
+  switch (blendingStyle) {
+    case BLEND_STYLE_FAIRY_DUST:  // fairy dust (must set entire segment, see isPixelXYClipped())
+      Segment::setClippingRect(0, w, 0, h);
+      break;
+    case BLEND_STYLE_SWIPE_RIGHT: // left-to-right
+    case BLEND_STYLE_PUSH_RIGHT:  // left-to-right
+      Segment::setClippingRect(0, dw, 0, h);
+      break;
+    case BLEND_STYLE_SWIPE_LEFT:  // right-to-left
+    case BLEND_STYLE_PUSH_LEFT:   // right-to-left
+      Segment::setClippingRect(w - dw, w, 0, h);
+      break;
+    case BLEND_STYLE_PINCH_OUT:   // corners
+      Segment::setClippingRect((w + dw)/2, (w - dw)/2, (h + dh)/2, (h - dh)/2); // inverted!!
+      break;
+    case BLEND_STYLE_INSIDE_OUT:  // outward
+      Segment::setClippingRect((w - dw)/2, (w + dw)/2, (h - dh)/2, (h + dh)/2);
+      break;
+    case BLEND_STYLE_SWIPE_DOWN:  // top-to-bottom (2D)
+    case BLEND_STYLE_PUSH_DOWN:   // top-to-bottom (2D)
+      Segment::setClippingRect(0, w, 0, dh);
+      break;
+    case BLEND_STYLE_SWIPE_UP:    // bottom-to-top (2D)
+    case BLEND_STYLE_PUSH_UP:     // bottom-to-top (2D)
+      Segment::setClippingRect(0, w, h - dh, h);
+      break;
+    case BLEND_STYLE_OPEN_H:      // horizontal-outward (2D) same look as INSIDE_OUT on 1D
+      Segment::setClippingRect((w - dw)/2, (w + dw)/2, 0, h);
+      break;
+    case BLEND_STYLE_OPEN_V:      // vertical-outward (2D)
+      Segment::setClippingRect(0, w, (h - dh)/2, (h + dh)/2);
+      break;
+    case BLEND_STYLE_PUSH_TL:     // TL-to-BR (2D)
+      Segment::setClippingRect(0, dw, 0, dh);
+      break;
+    case BLEND_STYLE_PUSH_TR:     // TR-to-BL (2D)
+      Segment::setClippingRect(w - dw, w, 0, dh);
+      break;
+    case BLEND_STYLE_PUSH_BR:     // BR-to-TL (2D)
+      Segment::setClippingRect(w - dw, w, h - dh, h);
+      break;
+    case BLEND_STYLE_PUSH_BL:     // BL-to-TR (2D)
+      Segment::setClippingRect(0, dw, h - dh, h);
+      break;
+    default:                      // fade
+      Segment::setClippingRect(0, 0);
+      break;
+  }
+}
+#endif
+
 // pixel is clipped if it falls outside clipping range (_modeBlend==true) or is inside clipping range (_modeBlend==false)
 // if clipping start > stop the clipping range is inverted
 // _modeBlend==true  -> old effect during transition
@@ -805,9 +982,6 @@ void IRAM_ATTR_YN Segment::setPixelColor(int i, uint32_t col) const
   if (is2D()) {
     const int vW = vWidth();   // segment width in logical pixels (can be 0 if segment is inactive)
     const int vH = vHeight();  // segment height in logical pixels (is always >= 1)
-    // pre-scale color for all pixels
-    col = color_fade(col, _segBri);
-    _colorScaled = true;
     switch (map1D2D) {
       case M12_Pixels:
         // use all available pixels as a long strip
@@ -899,17 +1073,7 @@ void IRAM_ATTR_YN Segment::setPixelColor(int i, uint32_t col) const
         break;
       }
     }
-    _colorScaled = false;
     return;
-  } else if (Segment::maxHeight != 1 && (width() == 1 || height() == 1)) {
-    if (start < Segment::maxWidth*Segment::maxHeight) {
-      // we have a vertical or horizontal 1D segment (WARNING: virtual...() may be transposed)
-      int x = 0, y = 0;
-      if (vHeight() > 1) y = i;
-      if (vWidth()  > 1) x = i;
-      setPixelColorXY(x, y, col);
-      return;
-    }
   }
 #endif
 
@@ -924,10 +1088,14 @@ void IRAM_ATTR_YN Segment::setPixelColor(int i, uint32_t col) const
 #endif
 
   if (i >= vL || i < 0 || isPixelClipped(i)) return; // handle clipping on 1D
+  if (unsigned(i) >= _pixelsLen) return; // no pixel buffer (yet)
+  pixels[i] = col; // during transition old effect draws into its own buffer (see swapSegenv())
+}
 
+// writes virtual pixel of a 1D segment to the LEDs
+void IRAM_ATTR_YN Segment::mapPixel(int i, uint32_t col) const
+{
   unsigned len = length();
-  // if color is unscaled
-  if (!_colorScaled) col = color_fade(col, _segBri);
 
   // expand pixel (taking into account start, grouping, spacing [and offset])
   i = i * groupLength();
@@ -940,7 +1108,6 @@ void IRAM_ATTR_YN Segment::setPixelColor(int i, uint32_t col) const
   }
   i += start; // starting pixel in a group
 
-  uint32_t tmpCol = col;
   // set all the pixels in the group
   for (int j = 0; j < grouping; j++) {
     unsigned indexSet = i + ((reverse) ? -j : j);
@@ -949,22 +1116,155 @@ void IRAM_ATTR_YN Segment::setPixelColor(int i, uint32_t col) const
         unsigned indexMir = stop - indexSet + start - 1;
         indexMir += offset; // offset/phase
         if (indexMir >= stop) indexMir -= len; // wrap
-#ifndef WLED_DISABLE_MODE_BLEND
-        // _modeBlend==true -> old effect
-        if (_modeBlend && blendingStyle == BLEND_STYLE_FADE) tmpCol = color_blend16(strip.getPixelColor(indexMir), col, 0xFFFFU - progress());
-#endif
-        strip.setPixelColor(indexMir, tmpCol);
+        indexSet += offset; // offset/phase
+        if (indexSet >= stop) indexSet -= len; // wrap
+        if (indexMir != indexSet) outputPixel(indexMir, col); // middle pixel of an odd length is composited once
+      } else {
+        indexSet += offset; // offset/phase
+        if (indexSet >= stop) indexSet -= len; // wrap
       }
-      indexSet += offset; // offset/phase
-      if (indexSet >= stop) indexSet -= len; // wrap
+      outputPixel(indexSet, col);
+    }
+  }
+}
+
+// hands a mapped pixel to the strip compositor, or records the mapping while buildPixelMap() runs (col is then the pixel buffer index)
+void IRAM_ATTR_YN Segment::outputPixel(unsigned i, uint32_t col) const
+{
+  if (_mapRecord) {
+    if (_mapRecordLen < _mapRecordCap) _mapRecord[_mapRecordLen] = (col << 16) | i;
+    _mapRecordLen++;
+    return;
+  }
+  strip.compositePixel(i, col);
+}
+
+// maps all pixels of px into the frame of the strip, with px == nullptr pixel buffer indices are mapped instead of colors
+void Segment::mapPixels(const uint32_t *px) const
+{
+#ifndef WLED_DISABLE_2D
+  const int vW = virtualWidth();
+  const int vH = virtualHeight();
+  if (is2D()) {
+    if (unsigned(vW * vH) != _pixelsLen) return; // buffer is resized in next service()
+    unsigned i = 0;
+    for (int y = 0; y < vH; y++) for (int x = 0; x < vW; x++, i++) mapPixelXY(x, y, px ? px[i] : i, vW, vH);
+    return;
+  }
+  if (Segment::maxHeight != 1 && (width() == 1 || height() == 1) && start < Segment::maxWidth*Segment::maxHeight) {
+    // we have a vertical or horizontal 1D segment (WARNING: virtual...() may be transposed)
+    const unsigned len = min(_pixelsLen, unsigned(virtualLength()));
+    for (unsigned i = 0; i < len; i++) mapPixelXY(vW > 1 ? i : 0, vH > 1 ? i : 0, px ? px[i] : i, vW, vH);
+    return;
+  }
+#endif
+  const unsigned len = min(_pixelsLen, unsigned(virtualLength()));
+  for (unsigned i = 0; i < len; i++) mapPixel(i, px ? px[i] : i);
+}
+
+// mapping of a segment only changes with its geometry, options, offset or the matrix setup (see invalidatePixelMap())
+// so it is recorded once as a list of frame/pixel buffer index pairs and flush() just walks the list
+bool Segment::buildPixelMap()
+{
+  const uint32_t key = (uint32_t(offset) << 16) | (options & 0x01CA); // reverse, mirror, reverse_y, mirror_y, transpose
+  if (_pixelMap && _pixelMapKey == key) return true;
+  invalidatePixelMap();
+  const unsigned cap = width() * height(); // each LED of the segment is composited at most once
+  _pixelMap = static_cast<uint32_t*>(malloc(cap * sizeof(uint32_t)));
+  if (!_pixelMap) return false;
+  _mapRecord = _pixelMap;
+  _mapRecordLen = 0;
+  _mapRecordCap = cap;
+  mapPixels(nullptr);
+  _mapRecord = nullptr;
+  if (_mapRecordLen == 0 || _mapRecordLen > cap) {
+    invalidatePixelMap(); // nothing to map yet or unexpected layout, use uncached mapping
+    return false;
+  }
+  _pixelMapLen = _mapRecordLen;
+  _pixelMapKey = key;
+  return true;
+}
+
+// maps pixel buffer into the frame of the strip, called for each segment by WS2812FX::show()
+// the strip composites the pixels with the segment's blend mode and brightness (opacity, on/off and its transition)
+void Segment::flush()
+{
+  if (!isActive() || !pixels) return;
 #ifndef WLED_DISABLE_MODE_BLEND
-        // _modeBlend==true -> old effect
-      if (_modeBlend && blendingStyle == BLEND_STYLE_FADE) tmpCol = color_blend16(strip.getPixelColor(indexSet), col, 0xFFFFU - progress());
+  if (hasTransitionBuffer()) {
+    flushTransition();
+    return;
+  }
+#endif
+  // plain 1D segment: pixel buffer lines up with the LEDs, no mapping needed
+  bool direct = !reverse && !mirror && grouping == 1 && spacing == 0 && offset == 0;
+#ifndef WLED_DISABLE_2D
+  direct = direct && !is2D() && (Segment::maxHeight == 1 || start >= Segment::maxWidth*Segment::maxHeight);
 #endif
-      strip.setPixelColor(indexSet, tmpCol);
+  if (direct) {
+    const unsigned len = min(_pixelsLen, unsigned(length()));
+    for (unsigned i = 0; i < len; i++) strip.compositePixel(start + i, pixels[i]);
+    return;
+  }
+  if (buildPixelMap()) {
+    const uint32_t *map = _pixelMap;
+    for (unsigned n = 0; n < _pixelMapLen; n++) strip.compositePixel(map[n] & 0xFFFF, pixels[map[n] >> 16]);
+    return;
+  }
+  mapPixels(pixels);
+}
+
+#ifndef WLED_DISABLE_MODE_BLEND
+// fade crossfades the old and the new effect in one pass (color_blend() handles two channels per operation),
+// other blending styles pick each pixel from the effect shown there and composite it with that effect's brightness
+// WS2812FX::show() restores the transition progress the frame was drawn with, so this matches the clipping used when drawing
+void Segment::flushTransition() const
+{
+  const uint32_t *oldPixels = _t->_segT._pixelsT;
+  const bool fade = blendingStyle == BLEND_STYLE_FADE || _pixelsLen == 1;
+  const uint8_t blend = progress() >> 8;
+  uint8_t briNew = 0, briOld = 0;
+  if (!fade) {
+    briNew = currentBri();
+    modeBlend(true); // brightness of old effect
+    briOld = currentBri();
+    modeBlend(false);
+  }
+#ifndef WLED_DISABLE_2D
+  const int vW = virtualWidth();
+  const int vH = virtualHeight();
+  if (is2D()) {
+    if (unsigned(vW * vH) != _pixelsLen) return; // buffer is resized in next service()
+    if (!fade) setTransitionClippingRect(vW, vH);
+    for (int y = 0, i = 0; y < vH; y++) for (int x = 0; x < vW; x++, i++) {
+      uint32_t c = pixels[i];
+      if (fade) c = color_blend(oldPixels[i], c, blend);
+      else if (isPixelXYClipped(x, y)) { c = oldPixels[i]; strip._layerOpacity = briOld; }
+      else strip._layerOpacity = briNew;
+      mapPixelXY(x, y, c, vW, vH);
     }
+    setClippingRect(0, 0);
+    return;
+  }
+  const bool inMatrix = Segment::maxHeight != 1 && (width() == 1 || height() == 1) && start < Segment::maxWidth*Segment::maxHeight;
+#endif
+  const unsigned len = min(_pixelsLen, unsigned(virtualLength()));
+  if (!fade) setTransitionClippingRect(len, 1);
+  for (unsigned i = 0; i < len; i++) {
+    uint32_t c = pixels[i];
+    if (fade) c = color_blend(oldPixels[i], c, blend);
+    else if (isPixelClipped(i)) { c = oldPixels[i]; strip._layerOpacity = briOld; }
+    else strip._layerOpacity = briNew;
+#ifndef WLED_DISABLE_2D
+    if (inMatrix) mapPixelXY(vW > 1 ? i : 0, vH > 1 ? i : 0, c, vW, vH);
+    else
+#endif
+    mapPixel(i, c);
   }
+  setClippingRect(0, 0);
 }
+#endif
 
 #ifdef WLED_USE_AA_PIXELS
 // anti-aliased normalized version of setPixelColor()
@@ -1074,14 +1374,7 @@ uint32_t IRAM_ATTR_YN Segment::getPixelColor(int i) const
 #endif
 
   if (i >= vL || i < 0 || isPixelClipped(i)) return 0; // handle clipping on 1D
-
-  if (reverse) i = vL - i - 1;
-  i *= groupLength();
-  i += start;
-  // offset/phase
-  i += offset;
-  if (i >= stop) i -= length();
-  return strip.getPixelColor(i);
+  return unsigned(i) < _pixelsLen ? pixels[i] : 0;
 }
 
 uint8_t Segment::differs(const Segment& b) const {
@@ -1101,6 +1394,7 @@ uint8_t Segment::differs(const Segment& b) const {
   if (custom3 != b.custom3)     d |= SEG_DIFFERS_FX;
   if (startY != b.startY)       d |= SEG_DIFFERS_BOUNDS;
   if (stopY != b.stopY)         d |= SEG_DIFFERS_BOUNDS;
+  if (blendMode != b.blendMode) d |= SEG_DIFFERS_OPT;
 
   //bit pattern: (msb first)
   // set:2, sound:2, mapping:3, transposed, mirrorY, reverseY, [reset,] paused, mirrored, on, reverse, [selected]
@@ -1164,16 +1458,16 @@ void Segment::refreshLightCapabilities() {
  */
 void Segment::fill(uint32_t c) {
   if (!isActive()) return; // not active
+  if (isBufferDirect()) {
+    std::fill(pixels, pixels + _pixelsLen, c);
+    return;
+  }
   const int cols = is2D() ? vWidth() : vLength();
   const int rows = vHeight(); // will be 1 for 1D
-  // pre-scale color for all pixels
-  c = color_fade(c, _segBri);
-  _colorScaled = true;
   for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) {
     if (is2D()) setPixelColorXY(x, y, c);
     else        setPixelColor(x, c);
   }
-  _colorScaled = false;
 }
 
 /*
@@ -1193,8 +1487,11 @@ void Segment::fade_out(uint8_t rate) {
   int g2 = G(color);
   int b2 = B(color);
 
+  const bool direct = isBufferDirect();
   for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) {
-    color = is2D() ? getPixelColorXY(x, y) : getPixelColor(x);
+    if (direct)      color = pixels[x + y * cols];
+    else if (is2D()) color = getPixelColorXY(x, y);
+    else             color = getPixelColor(x);
     if (color == colors[1]) continue; // already at target color
     int w1 = W(color);
     int r1 = R(color);
@@ -1212,14 +1509,24 @@ void Segment::fade_out(uint8_t rate) {
     gdelta += (g2 == g1) ? 0 : (g2 > g1) ? 1 : -1;
     bdelta += (b2 == b1) ? 0 : (b2 > b1) ? 1 : -1;
 
-    if (is2D()) setPixelColorXY(x, y, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
-    else        setPixelColor(x, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
+    if (direct)      pixels[x + y * cols] = RGBW32(r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
+    else if (is2D()) setPixelColorXY(x, y, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
+    else             setPixelColor(x, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
   }
 }
 
 // fades all pixels to black using nscale8()
 void Segment::fadeToBlackBy(uint8_t fadeBy) {
   if (!isActive() || fadeBy == 0) return;   // optimization - no scaling to apply
+  if (isBufferDirect()) {
+    // same as color_fade(c, 255-fadeBy) on every pixel, without branches so the compiler can unroll/vectorize it
+    const uint32_t scale = 256 - fadeBy;
+    for (unsigned i = 0; i < _pixelsLen; i++) {
+      const uint32_t c = pixels[i];
+      pixels[i] = ((((c & 0x00FF00FF) * scale) >> 8) & 0x00FF00FF) | ((((c >> 8) & 0x00FF00FF) * scale) & 0xFF00FF00);
+    }
+    return;
+  }
   const int cols = is2D() ? vWidth() : vLength();
   const int rows = vHeight(); // will be 1 for 1D
 
@@ -1246,6 +1553,10 @@ void Segment::blur(uint8_t blur_amount, bool smear) {
   uint8_t keep = smear ? 255 : 255 - blur_amount;
   uint8_t seep = blur_amount >> 1;
   unsigned vlength = vLength();
+  if (isBufferDirect()) {
+    blurPixels(pixels, vlength, 1, keep, seep);
+    return;
+  }
   uint32_t carryover = BLACK;
   uint32_t lastnew;       // not necessary to initialize lastnew and last, as both will be initialized by the first loop iteration
   uint32_t last;
@@ -1267,6 +1578,23 @@ void Segment::blur(uint8_t blur_amount, bool smear) {
   setPixelColor(vlength - 1, curnew);
 }
 
+// blurs a row or column of the pixel buffer in place (same as the blur loops using get/setPixelColor())
+// stride is the distance between neighbouring pixels: 1 for a row, virtual width for a column
+void IRAM_ATTR_YN Segment::blurPixels(uint32_t *px, unsigned len, unsigned stride, uint8_t keep, uint8_t seep) {
+  uint32_t carryover = BLACK;
+  uint32_t lastnew = BLACK;
+  for (unsigned i = 0; i < len; i++, px += stride) {
+    const uint32_t cur = *px;
+    const uint32_t part = color_fade(cur, seep);
+    uint32_t curnew = color_fade(cur, keep);
+    if (carryover) curnew = color_add(curnew, carryover);
+    if (i > 0) *(px - stride) = color_add(lastnew, part);
+    lastnew = curnew;
+    carryover = part;
+  }
+  if (len > 0) *(px - stride) = lastnew; // last pixel
+}
+
 /*
  * Put a value 0 to 255 in to get a color value.
  * The colours are a transition r -> g -> b -> back to r
@@ -1473,6 +1801,112 @@ void WS2812FX::finalizeInit() {
   deserializeMap();     // (re)load default ledmap (will also setUpMatrix() if ledmap does not exist)
 }
 
+// runs the effect of a segment that is due, both effects if it is in transition
+void WS2812FX::renderSegment(Segment &seg, unsigned long nowUp) {
+  unsigned frameDelay = FRAMETIME;
+  unsigned long segMicros = micros();
+
+  if (!seg.freeze) { //only run effect function if not frozen
+    // Effect blending
+    // When two effects are being blended, each may have different segment data, this
+    // data needs to be saved first and then restored before running previous mode.
+    // Each effect draws into its own pixel buffer, so effects that read back their pixels are not disturbed;
+    // segments that get no transition buffer (see WLED_MAX_TRANSITION_BUFFERS) only run the new effect.
+    seg.beginDraw();                      // set up parameters for get/setPixelColor()
+#ifndef WLED_DISABLE_MODE_BLEND
+    Segment::setClippingRect(0, 0); // disable clipping (just in case)
+    if (seg.hasTransitionBuffer()) {
+      // new mode draws into the segment buffer and old mode into the transition buffer, show() blends both
+      // with fade each mode draws the entire segment, otherwise new mode draws inside and old mode outside the clipping area
+      unsigned w = seg.is2D() ? Segment::vWidth() : Segment::vLength();
+      unsigned h = Segment::vHeight();
+      unsigned orgBS = blendingStyle;
+      if (w*h == 1) blendingStyle = BLEND_STYLE_FADE; // disable belending for single pixel segments (use fade instead)
+      Segment::setTransitionClippingRect(w, h);
+      frameDelay = (*_mode[seg.currentMode()])();  // run new/current mode
+      // now run old/previous mode
+      Segment::tmpsegd_t _tmpSegData;
+      Segment::modeBlend(true);           // set semaphore
+      seg.swapSegenv(_tmpSegData);        // temporarily store new mode state (and swap it with transitional state)
+      seg.beginDraw();                    // set up parameters for get/setPixelColor()
+      frameDelay = min(frameDelay, (unsigned)(*_mode[seg.currentMode()])());  // run old mode
+      seg.call++;                         // increment old mode run counter
+      seg.restoreSegenv(_tmpSegData);     // restore mode state (will also update transitional state)
+      Segment::modeBlend(false);          // unset semaphore
+      blendingStyle = orgBS;              // restore blending style if it was modified for single pixel segment
+    } else
+#endif
+    frameDelay = (*_mode[seg.mode])();         // run effect mode (not in transition)
+    seg.call++;
+    if (seg.isInTransition() && frameDelay > FRAMETIME) frameDelay = FRAMETIME; // force faster updates during transition
+  }
+
+  seg.next_time = nowUp + frameDelay;
+  Profiler::addSegment(_segment_index, seg.mode, micros() - segMicros);
+}
+
+#ifdef WLED_ENABLE_PARALLEL_FX
+// Segments that can be drawn on either core: running (effect data is allocated
+// in the first call), not in transition, without particle system memory and
+// not running an effect that sets FastLED's global random16() seed to replay a
+// sequence, since random16() calls on the other core would break the replay.
+bool WS2812FX::canRenderParallel(unsigned id) const {
+  const Segment &seg = _segments[id];
+  if (seg.freeze || seg.call == 0 || seg.isInTransition()) return false;
+  if (seg.mode == FX_MODE_RANDOM_CHASE || seg.mode == FX_MODE_TWINKLEUP || seg.mode == FX_MODE_2DCRAZYBEES) return false;
+  #if !(defined(WLED_DISABLE_PARTICLESYSTEM2D) && defined(WLED_DISABLE_PARTICLESYSTEM1D))
+  if (hasPSmemory(id)) return false;
+  #endif
+  return true;
+}
+
+// Draws the collected segments on both cores. Each core takes the next segment
+// from a shared counter, so the one that is done first takes over the rest;
+// the longest segments are handed out first to keep the cores evenly loaded.
+void WS2812FX::renderParallel(unsigned long nowUp) {
+  if (_renderJobCount == 0) return;
+  for (unsigned i = 1; i < _renderJobCount; i++) {
+    uint8_t id = _renderJobs[i];
+    unsigned len = _segments[id].length();
+    unsigned j = i;
+    for (; j > 0 && _segments[_renderJobs[j-1]].length() < len; j--) _renderJobs[j] = _renderJobs[j-1];
+    _renderJobs[j] = id;
+  }
+  if (!_renderDone) _renderDone = xSemaphoreCreateBinary();
+  if (!_renderTask && _renderDone && _renderJobCount > 1) {
+    // core 0 is shared with WiFi, which has higher priority
+    xTaskCreatePinnedToCore(renderTask, "FX_RENDER", WLED_RENDER_TASK_STACK, this, 1, &_renderTask, 0);
+    if (!_renderTask) DEBUG_PRINTLN(F("Cannot create render task."));
+  }
+  bool both = _renderTask && _renderJobCount > 1;
+  _renderNow = nowUp;
+  _renderNext = 0;
+  if (both) xTaskNotifyGive(_renderTask);
+  renderJobs();
+  if (both) xSemaphoreTake(_renderDone, portMAX_DELAY); // all segments are drawn before show()
+  _renderJobCount = 0;
+}
+
+void WS2812FX::renderJobs() {
+  unsigned job;
+  while (!_suspend && (job = _renderNext++) < _renderJobCount) {
+    _segment_index = _renderJobs[job];
+    Segment &seg = _segments[_segment_index];
+    seg.updateTransitionProgress(); // transition progress is kept per task
+    renderSegment(seg, _renderNow);
+  }
+}
+
+void WS2812FX::renderTask(void *arg) {
+  WS2812FX *fx = static_cast<WS2812FX*>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    fx->renderJobs();
+    xSemaphoreGive(fx->_renderDone);
+  }
+}
+#endif
+
 void WS2812FX::service() {
   unsigned long nowUp = millis(); // Be aware, millis() rolls over every 49 days
   now = nowUp + timebase;
@@ -1485,6 +1919,10 @@ void WS2812FX::service() {
   }
 
   bool doShow = false;
+  unsigned long effectsMicros = micros();
+#ifdef WLED_ENABLE_PARALLEL_FX
+  _renderJobCount = 0;
+#endif
 
   _isServicing = true;
   _segment_index = 0;
@@ -1497,107 +1935,27 @@ void WS2812FX::service() {
     // reset the segment runtime data if needed
     seg.resetIfRequired();
 
-    if (!seg.isActive()) continue;
+    // (re)allocate pixel buffer, segment options (mirror, transpose) may have changed its virtual size
+    if (!seg.isActive() || !seg.allocatePixels()) {
+      _segment_index++; // keep index in sync with _segments[] (SEGMENT)
+      continue;
+    }
 
     // last condition ensures all solid segments are updated at the same time
     if (nowUp >= seg.next_time || _triggered || (doShow && seg.mode == FX_MODE_STATIC))
     {
       doShow = true;
-      unsigned frameDelay = FRAMETIME;
-
-      if (!seg.freeze) { //only run effect function if not frozen
-        int oldCCT = BusManager::getSegmentCCT(); // store original CCT value (actually it is not Segment based)
-        // when correctWB is true we need to correct/adjust RGB value according to desired CCT value, but it will also affect actual WW/CW ratio
-        // when cctFromRgb is true we implicitly calculate WW and CW from RGB values
-        if (cctFromRgb) BusManager::setSegmentCCT(-1);
-        else            BusManager::setSegmentCCT(seg.currentBri(true), correctWB);
-        // Effect blending
-        // When two effects are being blended, each may have different segment data, this
-        // data needs to be saved first and then restored before running previous mode.
-        // The blending will largely depend on the effect behaviour since actual output (LEDs) may be
-        // overwritten by later effect. To enable seamless blending for every effect, additional LED buffer
-        // would need to be allocated for each effect and then blended together for each pixel.
-        seg.beginDraw();                      // set up parameters for get/setPixelColor()
-#ifndef WLED_DISABLE_MODE_BLEND
-        Segment::setClippingRect(0, 0); // disable clipping (just in case)
-        if (seg.isInTransition()) {
-          // set clipping rectangle
-          // new mode is run inside clipping area and old mode outside clipping area
-          unsigned p = seg.progress();
-          unsigned w = seg.is2D() ? Segment::vWidth() : Segment::vLength();
-          unsigned h = Segment::vHeight();
-          unsigned dw = p * w / 0xFFFFU + 1;
-          unsigned dh = p * h / 0xFFFFU + 1;
-          unsigned orgBS = blendingStyle;
-          if (w*h == 1) blendingStyle = BLEND_STYLE_FADE; // disable belending for single pixel segments (use fade instead)
-          switch (blendingStyle) {
-            case BLEND_STYLE_FAIRY_DUST:  // fairy dust (must set entire segment, see isPixelXYClipped())
-              Segment::setClippingRect(0, w, 0, h);
-              break;
-            case BLEND_STYLE_SWIPE_RIGHT: // left-to-right
-            case BLEND_STYLE_PUSH_RIGHT:  // left-to-right
-              Segment::setClippingRect(0, dw, 0, h);
-              break;
-            case BLEND_STYLE_SWIPE_LEFT:  // right-to-left
-            case BLEND_STYLE_PUSH_LEFT:   // right-to-left
-              Segment::setClippingRect(w - dw, w, 0, h);
-              break;
-            case BLEND_STYLE_PINCH_OUT:   // corners
-              Segment::setClippingRect((w + dw)/2, (w - dw)/2, (h + dh)/2, (h - dh)/2); // inverted!!
-              break;
-            case BLEND_STYLE_INSIDE_OUT:  // outward
-              Segment::setClippingRect((w - dw)/2, (w + dw)/2, (h - dh)/2, (h + dh)/2);
-              break;
-            case BLEND_STYLE_SWIPE_DOWN:  // top-to-bottom (2D)
-            case BLEND_STYLE_PUSH_DOWN:   // top-to-bottom (2D)
-              Segment::setClippingRect(0, w, 0, dh);
-              break;
-            case BLEND_STYLE_SWIPE_UP:    // bottom-to-top (2D)
-            case BLEND_STYLE_PUSH_UP:     // bottom-to-top (2D)
-              Segment::setClippingRect(0, w, h - dh, h);
-              break;
-            case BLEND_STYLE_OPEN_H:      // horizontal-outward (2D) same look as INSIDE_OUT on 1D
-              Segment::setClippingRect((w - dw)/2, (w + dw)/2, 0, h);
-              break;
-            case BLEND_STYLE_OPEN_V:      // vertical-outward (2D)
-              Segment::setClippingRect(0, w, (h - dh)/2, (h + dh)/2);
-              break;
-            case BLEND_STYLE_PUSH_TL:     // TL-to-BR (2D)
-              Segment::setClippingRect(0, dw, 0, dh);
-              break;
-            case BLEND_STYLE_PUSH_TR:     // TR-to-BL (2D)
-              Segment::setClippingRect(w - dw, w, 0, dh);
-              break;
-            case BLEND_STYLE_PUSH_BR:     // BR-to-TL (2D)
-              Segment::setClippingRect(w - dw, w, h - dh, h);
-              break;
-            case BLEND_STYLE_PUSH_BL:     // BL-to-TR (2D)
-              Segment::setClippingRect(0, dw, h - dh, h);
-              break;
-          }
-          frameDelay = (*_mode[seg.currentMode()])();  // run new/current mode
-          // now run old/previous mode
-          Segment::tmpsegd_t _tmpSegData;
-          Segment::modeBlend(true);           // set semaphore
-          seg.swapSegenv(_tmpSegData);        // temporarily store new mode state (and swap it with transitional state)
-          seg.beginDraw();                    // set up parameters for get/setPixelColor()
-          frameDelay = min(frameDelay, (unsigned)(*_mode[seg.currentMode()])());  // run old mode
-          seg.call++;                         // increment old mode run counter
-          seg.restoreSegenv(_tmpSegData);     // restore mode state (will also update transitional state)
-          Segment::modeBlend(false);          // unset semaphore
-          blendingStyle = orgBS;              // restore blending style if it was modified for single pixel segment
-        } else
+#ifdef WLED_ENABLE_PARALLEL_FX
+      if (canRenderParallel(_segment_index)) _renderJobs[_renderJobCount++] = _segment_index; // drawn on both cores below
+      else
 #endif
-        frameDelay = (*_mode[seg.mode])();         // run effect mode (not in transition)
-        seg.call++;
-        if (seg.isInTransition() && frameDelay > FRAMETIME) frameDelay = FRAMETIME; // force faster updates during transition
-        BusManager::setSegmentCCT(oldCCT); // restore old CCT for ABL adjustments
-      }
-
-      seg.next_time = nowUp + frameDelay;
+      renderSegment(seg, nowUp);
     }
     _segment_index++;
   }
+#ifdef WLED_ENABLE_PARALLEL_FX
+  renderParallel(nowUp);
+#endif
   Segment::setClippingRect(0, 0);             // disable clipping for overlays
   #if !(defined(WLED_DISABLE_PARTICLESYSTEM2D) && defined(WLED_DISABLE_PARTICLESYSTEM1D))
   servicePSmem(); // handle segment particle system memory
@@ -1609,8 +1967,12 @@ void WS2812FX::service() {
   if ((_targetFps != FPS_UNLIMITED) && (millis() - nowUp > _frametime)) DEBUG_PRINTF_P(PSTR("Slow effects %u/%d.\n"), (unsigned)(millis()-nowUp), (int)_frametime);
   #endif
   if (doShow) {
+    Profiler::add(PROFILE_EFFECTS, micros() - effectsMicros);
+    // how late this frame is, early triggered frames count as on time
+    if (_targetFps != FPS_UNLIMITED) Profiler::add(PROFILE_JITTER, elapsed > _frametime ? (elapsed - _frametime) * 1000 : 0);
     yield();
     Segment::handleRandomPalette(); // slowly transition random palette; move it into for loop when each segment has individual random palette
+    Segment::handleTransitionBuffers();
     show();
     _lastServiceShow = nowUp; // update timestamp, for precise FPS control
   }
@@ -1625,6 +1987,61 @@ void IRAM_ATTR WS2812FX::setPixelColor(unsigned i, uint32_t col) const {
   BusManager::setPixelColor(i, col);
 }
 
+// bulk variant of setPixelColor(), spans are handed to the buses directly unless a ledmap is in effect
+void IRAM_ATTR WS2812FX::setPixelsRGB(unsigned i, const uint8_t *data, unsigned count, bool rgbw) const {
+  if (customMappingSize && (realtimeMode == REALTIME_MODE_INACTIVE || realtimeRespectLedMaps)) {
+    const unsigned stride = 3 + rgbw;
+    for (unsigned n = 0; n < count; n++, data += stride) setPixelColor(i + n, RGBW32(data[0], data[1], data[2], rgbw ? data[3] : 0));
+    return;
+  }
+  if (i >= _length) return;
+  if (count > _length - i) count = _length - i;
+  BusManager::setPixelsRGB(i, data, count, rgbw);
+}
+
+// the frame covers getLengthTotal() pixels, CCT of each pixel is only kept if segments may differ in CCT
+bool WS2812FX::allocateFrame(bool withCCT) {
+  const unsigned len = getLengthTotal();
+  if (_pixelsLen != len) {
+    free(_pixels);
+    free(_pixelCCT);
+    _pixelCCT = nullptr;
+    _pixelsLen = 0;
+    // do not use SPI RAM on ESP32 since it is slow
+    _pixels = static_cast<uint32_t*>(malloc(len * sizeof(uint32_t)));
+    if (!_pixels) {
+      DEBUG_PRINTF_P(PSTR("!!! Frame buffer allocation failed (%u) !!!\n"), len);
+      errorFlag = ERR_NORAM;
+      return false;
+    }
+    _pixelsLen = len;
+  }
+  if (withCCT && !_pixelCCT) _pixelCCT = static_cast<uint8_t*>(calloc(_pixelsLen, 1)); // without it all pixels use the CCT of the last segment
+  else if (!withCCT && _pixelCCT) {
+    free(_pixelCCT);
+    _pixelCCT = nullptr;
+  }
+  return _pixels != nullptr;
+}
+
+// blends a pixel of the segment being flushed (with its blend mode and opacity) over the frame
+void IRAM_ATTR WS2812FX::compositePixel(unsigned i, uint32_t c) {
+  if (!_pixels) {
+    setPixelColor(i, color_fade(c, _layerOpacity));
+    return;
+  }
+  if (i >= _pixelsLen) return;
+  const uint32_t b = _pixels[i];
+  switch (_layerBlend) {
+    case BLEND_MODE_ADD:      c = color_add(b, c); break;
+    case BLEND_MODE_MULTIPLY: c = color_multiply(b, c); break;
+    case BLEND_MODE_SCREEN:   c = ~color_multiply(~b, ~c); break;
+    default: break;
+  }
+  _pixels[i] = _layerOpacity == 255 ? c : color_blend(b, c, _layerOpacity);
+  if (_pixelCCT) _pixelCCT[i] = _layerCCT;
+}
+
 uint32_t IRAM_ATTR WS2812FX::getPixelColor(unsigned i) const {
   i = getMappedPixelIndex(i);
   if (i >= _length) return 0;
@@ -1634,13 +2051,49 @@ uint32_t IRAM_ATTR WS2812FX::getPixelColor(unsigned i) const {
 void WS2812FX::show() {
   // avoid race condition, capture _callback value
   show_callback callback = _callback;
+  unsigned long showMicros = micros();
+  // composite segment pixel buffers into one frame and write it to the LEDs (unless realtime data owns all of them)
+  if (!realtimeMode || realtimeOverride || useMainSegmentOnly) {
+    int oldCCT = BusManager::getSegmentCCT(); // store original CCT value (actually it is not Segment based)
+    // when correctWB is true we need to correct/adjust RGB value according to desired CCT value, but it will also affect actual WW/CW ratio
+    // when cctFromRgb is true we implicitly calculate WW and CW from RGB values
+    const bool segmentCCT = !cctFromRgb && (correctWB || hasCCTBus());
+    if (allocateFrame(segmentCCT)) memset(_pixels, 0, _pixelsLen * sizeof(uint32_t));
+    else fill(BLACK); // out of memory: segments are drawn directly to the LEDs and the last one wins
+    for (segment &seg : _segments) {
+      if (!seg.isActive()) continue;
+      seg.restoreTransitionProgress(); // blend with the progress the segment was drawn with
+      _layerOpacity = seg.currentBri();
+      if (_layerOpacity == 0 && !seg.isInTransition()) continue; // fully transparent, nothing to composite
+      _layerBlend = seg.blendMode;
+      _layerCCT   = seg.currentBri(true);
+      if (!_pixels) BusManager::setSegmentCCT(segmentCCT ? _layerCCT : -1, correctWB);
+      seg.flush();
+    }
+    if (_pixels) {
+      // single pass over the frame, CCT is only changed between pixels of different segments
+      int cct = -1;
+      BusManager::setSegmentCCT(-1);
+      // ledmap (which includes the panel layout) is the only remaining lookup, checked once per frame instead of per pixel
+      const bool useMap = customMappingSize && (realtimeMode == REALTIME_MODE_INACTIVE || realtimeRespectLedMaps);
+      for (unsigned i = 0; i < _pixelsLen; i++) {
+        if (_pixelCCT && _pixelCCT[i] != cct) BusManager::setSegmentCCT(cct = _pixelCCT[i], correctWB);
+        const unsigned p = useMap && i < customMappingSize ? customMappingTable[i] : i;
+        if (p < _length) BusManager::setPixelColor(p, _pixels[i]);
+      }
+    }
+    BusManager::setSegmentCCT(oldCCT); // restore old CCT for ABL adjustments
+  }
   if (callback) callback();
   unsigned long showNow = millis();
 
   // some buses send asynchronously and this method will return before
   // all of the data has been sent.
   // See https://github.com/Makuna/NeoPixelBus/wiki/ESP32-NeoMethods#neoesp32rmt-methods
+  unsigned long busMicros = micros();
   BusManager::show();
+  Profiler::add(PROFILE_BUS, micros() - busMicros);
+  Profiler::add(PROFILE_SHOW, micros() - showMicros);
 
   size_t diff = showNow - _lastShow;
 
@@ -1894,8 +2347,10 @@ void WS2812FX::fixInvalidSegments() {
   // if any segments were deleted free memory
   purgeSegments();
   // this is always called as the last step after finalizeInit(), update covered bus types
-  for (segment &seg : _segments)
+  for (segment &seg : _segments) {
     seg.refreshLightCapabilities();
+    seg.invalidatePixelMap(); // bounds may have been clipped
+  }
 }
 
 //true if all segments align with a bus, or if a segment covers the total length
@@ -2076,6 +2531,7 @@ bool WS2812FX::deserializeMap(unsigned n) {
 
 
 WS2812FX* WS2812FX::instance = nullptr;
+WLED_DRAW_STATE uint8_t WS2812FX::_segment_index = 0;
 
 const char JSON_mode_names[] PROGMEM = R"=====(["FX names moved"])=====";
 const char JSON_palette_names[] PROGMEM = R"=====([
@@ -2311,6 +2311,13 @@ partMem* getPartMem(void) {
   return nullptr;
 }
 
+bool hasPSmemory(unsigned segID) {
+  for (const partMem &pmem : partMemList) {
+    if (pmem.id == segID) return true;
+  }
+  return false;
+}
+
 // function to update the framebuffer and renderbuffer
 void updateRenderingBuffer(uint32_t requiredpixels, bool isFramebuffer, bool initialize) {
   PSPRINTLN("updateRenderingBuffer");
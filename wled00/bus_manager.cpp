@@ -109,6 +109,32 @@ void Bus::freeData() {
   _data = nullptr;
 }
 
+// generic bulk write, buses that can do better override it
+void Bus::setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw) {
+  const unsigned stride = 3 + rgbw;
+  for (unsigned i = 0; i < count; i++, data += stride) setPixelColor(pix + i, RGBW32(data[0], data[1], data[2], rgbw ? data[3] : 0));
+}
+
+// copies packed pixels between buffers with 3 or 4 channels per pixel (missing white is written as 0)
+// returns true if the destination changed
+static bool copyPixels(uint8_t *dst, unsigned dstChannels, const uint8_t *src, unsigned srcChannels, unsigned count) {
+  if (dstChannels == srcChannels) {
+    const size_t len = count * srcChannels;
+    if (memcmp(dst, src, len) == 0) return false;
+    memcpy(dst, src, len);
+    return true;
+  }
+  bool changed = false;
+  for (unsigned i = 0; i < count; i++, dst += dstChannels, src += srcChannels) {
+    changed |= dst[0] != src[0] || dst[1] != src[1] || dst[2] != src[2] || (dstChannels > 3 && dst[3]);
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+    if (dstChannels > 3) dst[3] = 0;
+  }
+  return changed;
+}
+
 BusDigital::BusDigital(const BusConfig &bc, uint8_t nr, const ColorOrderMap &com)
 : Bus(bc.type, bc.start, bc.autoWhite, bc.count, bc.reversed, (bc.refreshReq || bc.type == TYPE_TM1814))
 , _skip(bc.skipAmount) //sacrificial pixels
@@ -116,6 +142,7 @@ BusDigital::BusDigital(const BusConfig &bc, uint8_t nr, const ColorOrderMap &com
 , _milliAmpsPerLed(bc.milliAmpsPerLed)
 , _milliAmpsMax(bc.milliAmpsMax)
 , _colorOrderMap(com)
+, _milliAmpsTotal(0)
 {
   DEBUGBUS_PRINTLN(F("Bus: Creating digital bus."));
   if (!isDigital(bc.type) || !bc.count) { DEBUGBUS_PRINTLN(F("Not digial or empty bus!")); return; }
@@ -162,7 +189,7 @@ BusDigital::BusDigital(const BusConfig &bc, uint8_t nr, const ColorOrderMap &com
 //I am NOT to be held liable for burned down garages or houses!
 
 // To disable brightness limiter we either set output max current to 0 or single LED current to 0
-uint8_t BusDigital::estimateCurrentAndLimitBri() const {
+uint8_t BusDigital::estimateCurrentAndLimitBri() {
   bool useWackyWS2815PowerModel = false;
   byte actualMilliampsPerLed = _milliAmpsPerLed;
 
@@ -200,21 +227,21 @@ uint8_t BusDigital::estimateCurrentAndLimitBri() const {
   }
 
   // powerSum has all the values of channels summed (max would be getLength()*765 as white is excluded) so convert to milliAmps
-  BusDigital::_milliAmpsTotal = (busPowerSum * actualMilliampsPerLed * _bri) / (765*255);
+  _milliAmpsTotal = (busPowerSum * actualMilliampsPerLed * _bri) / (765*255);
 
   uint8_t newBri = _bri;
-  if (BusDigital::_milliAmpsTotal > powerBudget) {
+  if (_milliAmpsTotal > powerBudget) {
     //scale brightness down to stay in current limit
-    unsigned scaleB = powerBudget * 255 / BusDigital::_milliAmpsTotal;
+    unsigned scaleB = powerBudget * 255 / _milliAmpsTotal;
     newBri = (_bri * scaleB) / 256 + 1;
-    BusDigital::_milliAmpsTotal = powerBudget;
+    _milliAmpsTotal = powerBudget;
     //_milliAmpsTotal = (busPowerSum * actualMilliampsPerLed * newBri) / (765*255);
   }
   return newBri;
 }
 
 void BusDigital::show() {
-  BusDigital::_milliAmpsTotal = 0;
+  _milliAmpsTotal = 0;
   if (!_valid) return;
 
   uint8_t cctWW = 0, cctCW = 0;
@@ -300,8 +327,9 @@ void IRAM_ATTR BusDigital::setPixelColor(unsigned pix, uint32_t c) {
   if (hasWhite()) c = autoWhiteCalc(c);
   if (Bus::_cct >= 1900) c = colorBalanceFromKelvin(Bus::_cct, c); //color correction from CCT
   if (_data) {
-    size_t offset = pix * getNumberOfChannels();
-    uint8_t* dataptr = _data + offset;
+    const unsigned channels = getNumberOfChannels();
+    uint8_t px[5];
+    uint8_t* dataptr = px;
     if (hasRGB()) {
       *dataptr++ = R(c);
       *dataptr++ = G(c);
@@ -311,7 +339,12 @@ void IRAM_ATTR BusDigital::setPixelColor(unsigned pix, uint32_t c) {
     // unfortunately as a segment may span multiple buses or a bus may contain multiple segments and each segment may have different CCT
     // we need to store CCT value for each pixel (if there is a color correction in play, convert K in CCT ratio)
     if (hasCCT()) *dataptr = Bus::_cct >= 1900 ? (Bus::_cct - 1900) >> 5 : (Bus::_cct < 0 ? 127 : Bus::_cct); // TODO: if _cct == -1 we simply ignore it
+    uint8_t* pixptr = _data + pix * channels;
+    if (memcmp(pixptr, px, channels) == 0) return; // unchanged, bus need not be sent again
+    memcpy(pixptr, px, channels);
+    _dirty = true;
   } else {
+    _dirty = true; // pixels are written straight into the driver buffer, no cheap way to tell if they changed
     if (_reversed) pix = _len - pix -1;
     pix += _skip;
     unsigned co = _colorOrderMap.getPixelColorOrder(pix+_start, _colorOrder);
@@ -336,6 +369,29 @@ void IRAM_ATTR BusDigital::setPixelColor(unsigned pix, uint32_t c) {
   }
 }
 
+// writes packed RGB(W) pixels; buffered buses copy the span as is (color order is applied in show())
+void IRAM_ATTR BusDigital::setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw) {
+  if (!_valid) return;
+  if (hasCCT() || !hasRGB() || needsAutoWhite() || Bus::_cct >= 1900) {
+    Bus::setPixelsRGB(pix, data, count, rgbw); // needs per pixel white/CCT handling
+    return;
+  }
+  const unsigned stride = 3 + rgbw;
+  if (_data) {
+    const unsigned channels = getNumberOfChannels();
+    _dirty |= copyPixels(_data + pix * channels, channels, data, stride, count);
+    return;
+  }
+  _dirty = true;
+  for (unsigned i = 0; i < count; i++, data += stride) {
+    unsigned p = pix + i;
+    if (_reversed) p = _len - p -1;
+    p += _skip;
+    unsigned co = _colorOrderMap.getPixelColorOrder(p+_start, _colorOrder);
+    PolyBus::setPixelColor(_busPtr, _iType, p, RGBW32(data[0], data[1], data[2], rgbw ? data[3] : 0), co);
+  }
+}
+
 // returns original color if global buffering is enabled, else returns lossly restored color from bus
 uint32_t IRAM_ATTR BusDigital::getPixelColor(unsigned pix) const {
   if (!_valid) return 0;
@@ -384,6 +440,7 @@ unsigned BusDigital::getBusSize() const {
 void BusDigital::setColorOrder(uint8_t colorOrder) {
   // upper nibble contains W swap information
   if ((colorOrder & 0x0F) > 5) return;
+  _dirty |= _colorOrder != colorOrder;
   _colorOrder = colorOrder;
 }
 
@@ -416,6 +473,7 @@ std::vector<LEDType> BusDigital::getLEDTypes() {
 void BusDigital::begin() {
   if (!_valid) return;
   PolyBus::begin(_busPtr, _iType, _pins, _frequencykHz);
+  _dirty = true;
 }
 
 void BusDigital::cleanup() {
@@ -504,6 +562,7 @@ BusPwm::BusPwm(const BusConfig &bc)
 
 void BusPwm::setPixelColor(unsigned pix, uint32_t c) {
   if (pix != 0 || !_valid) return; //only react to first pixel
+  _dirty = true; // updating duty cycles is cheap, no need to compare
   if (_type != TYPE_ANALOG_3CH) c = autoWhiteCalc(c);
   if (Bus::_cct >= 1900 && (_type == TYPE_ANALOG_3CH || _type == TYPE_ANALOG_4CH)) {
     c = colorBalanceFromKelvin(Bus::_cct, c); //color correction from CCT
@@ -691,7 +750,9 @@ void BusOnOff::setPixelColor(unsigned pix, uint32_t c) {
   uint8_t g = G(c);
   uint8_t b = B(c);
   uint8_t w = W(c);
-  _data[0] = bool(r|g|b|w) && bool(_bri) ? 0xFF : 0;
+  uint8_t state = bool(r|g|b|w) && bool(_bri) ? 0xFF : 0;
+  _dirty |= _data[0] != state;
+  _data[0] = state;
 }
 
 uint32_t BusOnOff::getPixelColor(unsigned pix) const {
@@ -748,11 +809,22 @@ void BusNetwork::setPixelColor(unsigned pix, uint32_t c) {
   if (!_valid || pix >= _len) return;
   if (_hasWhite) c = autoWhiteCalc(c);
   if (Bus::_cct >= 1900) c = colorBalanceFromKelvin(Bus::_cct, c); //color correction from CCT
-  unsigned offset = pix * _UDPchannels;
-  _data[offset]   = R(c);
-  _data[offset+1] = G(c);
-  _data[offset+2] = B(c);
-  if (_hasWhite) _data[offset+3] = W(c);
+  uint8_t *px = _data + pix * _UDPchannels;
+  if (px[0] == R(c) && px[1] == G(c) && px[2] == B(c) && (!_hasWhite || px[3] == W(c))) return; // unchanged
+  px[0] = R(c);
+  px[1] = G(c);
+  px[2] = B(c);
+  if (_hasWhite) px[3] = W(c);
+  _dirty = true;
+}
+
+void BusNetwork::setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw) {
+  if (!_valid || pix >= _len) return;
+  if (needsAutoWhite() || Bus::_cct >= 1900) {
+    Bus::setPixelsRGB(pix, data, count, rgbw);
+    return;
+  }
+  _dirty |= copyPixels(_data + pix * _UDPchannels, _UDPchannels, data, 3 + rgbw, min(count, unsigned(_len - pix)));
 }
 
 uint32_t BusNetwork::getPixelColor(unsigned pix) const {
@@ -977,11 +1049,22 @@ void BusManager::off() {
   #endif
 }
 
+// buses are only sent if their pixel data changed since the last show(), if they need a continuous
+// refresh (off refresh, PWM dithering) or when the keep-alive interval has passed
 void BusManager::show() {
+  const unsigned long now = millis();
+  const bool keepAlive = _keepAlive == 0 || now - _lastKeepAlive >= _keepAlive;
+  if (keepAlive) _lastKeepAlive = now;
   _milliAmpsUsed = 0;
   for (auto &bus : busses) {
-    bus->show();
-    _milliAmpsUsed += bus->getUsedCurrent();
+    if (keepAlive || bus->isDirty() || bus->isOffRefreshRequired()) {
+      bus->show();
+      bus->setDirty(false);
+      _framesSent++;
+    } else {
+      _framesSkipped++;
+    }
+    _milliAmpsUsed += bus->getUsedCurrent(); // skipped buses report the current of their last show()
   }
 }
 
@@ -997,6 +1080,20 @@ void IRAM_ATTR BusManager::setPixelColor(unsigned pix, uint32_t c) {
   }
 }
 
+// splits the span at bus boundaries so each bus receives one contiguous write
+void IRAM_ATTR BusManager::setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw) {
+  const unsigned end = pix + count;
+  const unsigned stride = 3 + rgbw;
+  for (auto &bus : busses) {
+    unsigned bstart = bus->getStart();
+    unsigned bend = bstart + bus->getLength();
+    unsigned first = max(pix, bstart);
+    unsigned last = min(end, bend);
+    if (first >= last) continue;
+    bus->setPixelsRGB(first - bstart, data + (first - pix) * stride, last - first, rgbw);
+  }
+}
+
 void BusManager::setBrightness(uint8_t b) {
   for (auto &bus : busses) bus->setBrightness(b);
 }
@@ -1043,10 +1140,12 @@ int16_t Bus::_cct = -1;
 uint8_t Bus::_cctBlend = 0;
 uint8_t Bus::_gAWM = 255;
 
-uint16_t BusDigital::_milliAmpsTotal = 0;
-
 //std::vector<std::unique_ptr<Bus>> BusManager::busses;
 std::vector<Bus*> BusManager::busses;
 ColorOrderMap BusManager::colorOrderMap = {};
 uint16_t      BusManager::_milliAmpsUsed = 0;
 uint16_t      BusManager::_milliAmpsMax = ABL_MILLIAMPS_DEFAULT;
+uint16_t      BusManager::_keepAlive = BUS_KEEPALIVE_DEFAULT;
+uint32_t      BusManager::_lastKeepAlive = 0;
+uint32_t      BusManager::_framesSent = 0;
+uint32_t      BusManager::_framesSkipped = 0;
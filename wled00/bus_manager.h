@@ -98,6 +98,7 @@ class Bus {
     , _reversed(reversed)
     , _valid(false)
     , _needsRefresh(refresh)
+    , _dirty(true)
     , _data(nullptr) // keep data access consistent across all types of buses
     {
       _autoWhiteMode = Bus::hasWhite(type) ? aw : RGBW_MODE_MANUAL_ONLY;
@@ -110,7 +111,8 @@ class Bus {
     virtual bool     canShow() const                            { return true; }
     virtual void     setStatusPixel(uint32_t c)                 {}
     virtual void     setPixelColor(unsigned pix, uint32_t c) = 0;
-    virtual void     setBrightness(uint8_t b)                   { _bri = b; };
+    virtual void     setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw = false); // bulk write of packed RGB (or RGBW) pixels, pix is bus relative
+    virtual void     setBrightness(uint8_t b)                   { _dirty |= _bri != b; _bri = b; };
     virtual void     setColorOrder(uint8_t co)                  {}
     virtual uint32_t getPixelColor(unsigned pix) const          { return 0; }
     virtual unsigned getPins(uint8_t* pinArray = nullptr) const { return 0; }
@@ -143,6 +145,8 @@ class Bus {
     inline  bool     isOk() const                               { return _valid; }
     inline  bool     isReversed() const                         { return _reversed; }
     inline  bool     isOffRefreshRequired() const               { return _needsRefresh; }
+    inline  bool     isDirty() const                            { return _dirty; } // pixel data changed since last show()
+    inline  void     setDirty(bool dirty = true)                { _dirty = dirty; }
     inline  bool     containsPixel(uint16_t pix) const          { return pix >= _start && pix < _start + _len; }
 
     static inline std::vector<LEDType> getLEDTypes()            { return {{TYPE_NONE, "", PSTR("None")}}; } // not used. just for reference for derived classes
@@ -197,6 +201,7 @@ class Bus {
       bool _reversed;//     : 1;
       bool _valid;//        : 1;
       bool _needsRefresh;// : 1;
+      bool _dirty;//        : 1;
       bool _hasRgb;//       : 1;
       bool _hasWhite;//     : 1;
       bool _hasCCT;//       : 1;
@@ -217,6 +222,7 @@ class Bus {
     static uint8_t _cctBlend;
 
     uint32_t autoWhiteCalc(uint32_t c) const;
+    inline bool needsAutoWhite() const { return hasWhite() && (_gAWM < AW_GLOBAL_DISABLED ? _gAWM : _autoWhiteMode) != RGBW_MODE_MANUAL_ONLY; }
     uint8_t *allocateData(size_t size = 1);
     void     freeData();
 };
@@ -232,6 +238,7 @@ class BusDigital : public Bus {
     void setBrightness(uint8_t b) override;
     void setStatusPixel(uint32_t c) override;
     [[gnu::hot]] void setPixelColor(unsigned pix, uint32_t c) override;
+    [[gnu::hot]] void setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw = false) override;
     void setColorOrder(uint8_t colorOrder) override;
     [[gnu::hot]] uint32_t getPixelColor(unsigned pix) const override;
     uint8_t  getColorOrder() const override  { return _colorOrder; }
@@ -258,7 +265,7 @@ class BusDigital : public Bus {
     void * _busPtr;
     const ColorOrderMap &_colorOrderMap;
 
-    static uint16_t _milliAmpsTotal; // is overwitten/recalculated on each show()
+    uint16_t _milliAmpsTotal; // is recalculated on each show(), kept while show() is skipped
 
     inline uint32_t restoreColorLossy(uint32_t c, uint8_t restoreBri) const {
       if (restoreBri < 255) {
@@ -271,7 +278,7 @@ class BusDigital : public Bus {
       return c;
     }
 
-    uint8_t  estimateCurrentAndLimitBri() const;
+    uint8_t  estimateCurrentAndLimitBri();
 };
 
 
@@ -330,6 +337,7 @@ class BusNetwork : public Bus {
 
     bool canShow() const override  { return !_broadcastLock; } // this should be a return value from UDP routine if it is still sending data out
     [[gnu::hot]] void setPixelColor(unsigned pix, uint32_t c) override;
+    [[gnu::hot]] void setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw = false) override;
     [[gnu::hot]] uint32_t getPixelColor(unsigned pix) const override;
     unsigned getPins(uint8_t* pinArray = nullptr) const override;
     unsigned getBusSize() const override  { return sizeof(BusNetwork) + (isOk() ? _len * _UDPchannels : 0); }
@@ -434,15 +442,22 @@ class BusManager {
     static void on();
     static void off();
 
+    // buses whose pixel data did not change are skipped, see setKeepAlive()
     static void show();
     static bool canAllShow();
     static void setStatusPixel(uint32_t c);
     [[gnu::hot]] static void setPixelColor(unsigned pix, uint32_t c);
+    [[gnu::hot]] static void setPixelsRGB(unsigned pix, const uint8_t *data, unsigned count, bool rgbw = false); // writes count packed RGB (or RGBW) pixels starting at pix
     static void setBrightness(uint8_t b);
     // for setSegmentCCT(), cct can only be in [-1,255] range; allowWBCorrection will convert it to K
     // WARNING: setSegmentCCT() is a misleading name!!! much better would be setGlobalCCT() or just setCCT()
     static void setSegmentCCT(int16_t cct, bool allowWBCorrection = false);
     static inline void setMilliampsMax(uint16_t max) { _milliAmpsMax = max;}
+    // unchanged buses are still sent every ms milliseconds (0 sends all buses every frame)
+    static inline void setKeepAlive(uint16_t ms) { _keepAlive = ms; }
+    static inline uint16_t getKeepAlive() { return _keepAlive; }
+    static inline uint32_t getFramesSent() { return _framesSent; }       // bus updates sent
+    static inline uint32_t getFramesSkipped() { return _framesSkipped; } // bus updates skipped as unchanged
     [[gnu::hot]] static uint32_t getPixelColor(unsigned pix);
     static inline int16_t getSegmentCCT() { return Bus::getCCT(); }
 
@@ -461,6 +476,10 @@ class BusManager {
     static ColorOrderMap colorOrderMap;
     static uint16_t _milliAmpsUsed;
     static uint16_t _milliAmpsMax;
+    static uint16_t _keepAlive;
+    static uint32_t _lastKeepAlive;
+    static uint32_t _framesSent;
+    static uint32_t _framesSkipped;
 
     #ifdef ESP32_DATA_IDLE_HIGH
     static void    esp32RMTInvertIdle() ;
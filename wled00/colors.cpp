@@ -58,6 +58,16 @@ uint32_t color_add(uint32_t c1, uint32_t c2, bool preserveCR)
   }
 }
 
+/*
+ * color multiply function, each channel is scaled by the same channel of the other color (white * c = c)
+ */
+uint32_t color_multiply(uint32_t c1, uint32_t c2)
+{
+  uint32_t result = 0;
+  for (unsigned shift = 0; shift < 32; shift += 8) result |= (((((c1 >> shift) & 0xFF) * ((c2 >> shift) & 0xFF)) + 0xFF) >> 8) << shift;
+  return result;
+}
+
 /*
  * fades color toward black
  * if using "video" method the resulting color will never become black unless it is already black
@@ -44,6 +44,21 @@
   #endif
 #endif
 
+// render segment effects on both cores (dual core ESP32 only)
+#ifdef WLED_ENABLE_PARALLEL_FX
+  #if !defined(ARDUINO_ARCH_ESP32) || defined(CONFIG_FREERTOS_UNICORE)
+    #undef WLED_ENABLE_PARALLEL_FX
+  #endif
+#endif
+#ifdef WLED_ENABLE_PARALLEL_FX
+  #define WLED_DRAW_STATE thread_local  // state of the segment being drawn is kept per task
+  #ifndef WLED_RENDER_TASK_STACK
+    #define WLED_RENDER_TASK_STACK 8192 // same as the Arduino loop task that runs effects otherwise
+  #endif
+#else
+  #define WLED_DRAW_STATE
+#endif
+
 #ifndef WLED_MAX_BUSSES
   #ifdef ESP8266
     #define WLED_MAX_DIGITAL_CHANNELS 3
@@ -529,6 +544,10 @@
   #endif
 #endif
 
+#ifndef BUS_KEEPALIVE_DEFAULT
+  #define BUS_KEEPALIVE_DEFAULT 1000  // ms, outputs without new pixel data are re-sent at this interval (0 sends every frame)
+#endif
+
 #ifndef LED_MILLIAMPS_DEFAULT
   #define LED_MILLIAMPS_DEFAULT 55    // common WS2812B
 #else
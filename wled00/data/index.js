@@ -811,6 +811,14 @@ function populateSegments(s)
 							`<option value="3" ${inst.si==3?' selected':''}>14/3</option>`+
 						`</select></div>`+
 					`</div>`;
+		let blend = `<div class="lbl-s">Blend<br>`+
+						`<div class="sel-p"><select class="sel-p" id="seg${i}bm" onchange="setBm(${i})">`+
+							`<option value="0" ${inst.bm==0?' selected':''}>Normal</option>`+
+							`<option value="1" ${inst.bm==1?' selected':''}>Add</option>`+
+							`<option value="2" ${inst.bm==2?' selected':''}>Multiply</option>`+
+							`<option value="3" ${inst.bm==3?' selected':''}>Screen</option>`+
+						`</select></div>`+
+					`</div>`;
 		cn += `<div class="seg lstI ${i==s.mainseg && !simplifiedUI ? 'selected' : ''} ${exp ? "expanded":""}" id="seg${i}" data-set="${inst.set}">`+
 				`<label class="check schkl ${smpl}">`+
 					`<input type="checkbox" id="seg${i}sel" onchange="selSeg(${i})" ${inst.sel ? "checked":""}>`+
@@ -861,6 +869,7 @@ function populateSegments(s)
 					(!isMSeg ? rvXck : '') +
 					(isMSeg&&stoY-staY>1&&stoX-staX>1 ? map2D : '') +
 					(s.AudioReactive && s.AudioReactive.on ? "" : sndSim) +
+					blend +
 					`<label class="check revchkl" id="seg${i}lbtm">`+
 						(isMSeg?'Transpose':'Mirror effect') + (isMSeg ?
 						'<input type="checkbox" id="seg'+i+'tp" onchange="setTp('+i+')" '+(inst.tp?"checked":"")+'>':
@@ -2299,6 +2308,13 @@ function setM12(s)
 	requestJson(obj);
 }
 
+function setBm(s)
+{
+	var value = gId(`seg${s}bm`).selectedIndex;
+	var obj = {"seg": {"id": s, "bm": value}};
+	requestJson(obj);
+}
+
 function setSi(s)
 {
 	var value = gId(`seg${s}si`).selectedIndex;
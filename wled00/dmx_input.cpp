@@ -222,11 +222,14 @@ void DMXInput::update()
 
 void DMXInput::turnOnAllLeds()
 {
-  // TODO not sure if this is the correct way?
+  // written as realtime data, otherwise show() draws the segments over it
+  realtimeLock(realtimeTimeoutMs, REALTIME_MODE_DMX);
+  if (realtimeOverride && !(realtimeMode && useMainSegmentOnly)) return;
+  if (useMainSegmentOnly) strip.getMainSegment().beginDraw();
   const uint16_t numPixels = strip.getLengthTotal();
   for (uint16_t i = 0; i < numPixels; ++i)
   {
-    strip.setPixelColor(i, 255, 255, 255, 255);
+    setRealtimePixel(i, 255, 255, 255, 255);
   }
   strip.setBrightness(255, true);
   strip.show();
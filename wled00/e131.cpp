@@ -40,9 +40,7 @@ void handleDDPPacket(e131_packet_t* p) {
 
   if (!realtimeOverride || (realtimeMode && useMainSegmentOnly)) {
     if (useMainSegmentOnly) strip.getMainSegment().beginDraw();
-    for (unsigned i = start; i < stop; i++, c += ddpChannelsPerLed) {
-      setRealtimePixel(i, data[c], data[c+1], data[c+2], ddpChannelsPerLed >3 ? data[c+3] : 0);
-    }
+    if (stop > start) setRealtimePixels(start, data + c, stop - start, ddpChannelsPerLed > 3);
   }
 
   bool push = p->flags & DDP_PUSH_FLAG;
@@ -317,17 +315,7 @@ void handleDMXData(uint16_t uni, uint16_t dmxChannels, uint8_t* e131_data, uint8
         }
 
         if (useMainSegmentOnly) strip.getMainSegment().beginDraw();
-        if (!is4Chan) {
-          for (unsigned i = previousLeds; i < ledsTotal; i++) {
-            setRealtimePixel(i, e131_data[dmxOffset], e131_data[dmxOffset+1], e131_data[dmxOffset+2], 0);
-            dmxOffset+=3;
-          }
-        } else {
-          for (unsigned i = previousLeds; i < ledsTotal; i++) {
-            setRealtimePixel(i, e131_data[dmxOffset], e131_data[dmxOffset+1], e131_data[dmxOffset+2], e131_data[dmxOffset+3]);
-            dmxOffset+=4;
-          }
-        }
+        if (ledsTotal > previousLeds) setRealtimePixels(previousLeds, e131_data + dmxOffset, ledsTotal - previousLeds, is4Chan);
         break;
       }
     default:
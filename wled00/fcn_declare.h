@@ -167,6 +167,7 @@ class NeoGammaWLEDMethod {
 [[gnu::hot, gnu::pure]] uint32_t color_blend(uint32_t c1, uint32_t c2 , uint8_t blend);
 inline uint32_t color_blend16(uint32_t c1, uint32_t c2, uint16_t b) { return color_blend(c1, c2, b >> 8); };
 [[gnu::hot, gnu::pure]] uint32_t color_add(uint32_t, uint32_t, bool preserveCR = false);
+[[gnu::hot, gnu::pure]] uint32_t color_multiply(uint32_t c1, uint32_t c2);
 [[gnu::hot, gnu::pure]] uint32_t color_fade(uint32_t c1, uint8_t amount, bool video=false);
 [[gnu::hot, gnu::pure]] uint32_t ColorFromPaletteWLED(const CRGBPalette16 &pal, unsigned index, uint8_t brightness = (uint8_t)255U, TBlendType blendType = LINEARBLEND);
 CRGBPalette16 generateHarmonicRandomPalette(const CRGBPalette16 &basepalette);
@@ -354,6 +355,7 @@ void realtimeLock(uint32_t timeoutMs, byte md = REALTIME_MODE_GENERIC);
 void exitRealtime();
 void handleNotifications();
 void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w);
+void setRealtimePixels(uint16_t i, const uint8_t *data, unsigned count, bool rgbw = false);
 void refreshNodeList();
 void sendSysInfoUDP();
 #ifndef WLED_DISABLE_ESPNOW
@@ -427,6 +429,8 @@ class Usermod {
     virtual bool onEspNowMessage(uint8_t* sender, uint8_t* payload, uint8_t len) { return false; } // fired upon ESP-NOW message received
     virtual void onUpdateBegin(bool) {}                                      // fired prior to and after unsuccessful firmware update
     virtual void onStateChange(uint8_t mode) {}                              // fired upon WLED state change
+    virtual void onRealtimePixels(unsigned start, const uint8_t* data, unsigned count, bool rgbw) {} // raw RGB(W) realtime data before it is written to the LEDs (may run in the network task)
+    virtual void onRealtimeShow() {}                                         // a complete realtime frame is about to be shown
     virtual uint16_t getId() {return USERMOD_ID_UNSPECIFIED;}
 
   // API shims
@@ -468,6 +472,8 @@ namespace UsermodManager {
 #endif
   void onUpdateBegin(bool);
   void onStateChange(uint8_t);
+  void onRealtimePixels(unsigned start, const uint8_t* data, unsigned count, bool rgbw);
+  void onRealtimeShow();
   bool add(Usermod* um);
   Usermod* lookup(uint16_t mod_id);
   inline byte getModCount() {return numMods;};
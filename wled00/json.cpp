@@ -240,10 +240,15 @@ bool deserializeSegment(JsonObject elem, byte it, byte presetId)
   seg.check2 = getBoolVal(elem["o2"], seg.check2);
   seg.check3 = getBoolVal(elem["o3"], seg.check3);
 
+  uint8_t blendMode = elem["bm"] | seg.blendMode;
+  seg.blendMode = blendMode < BLEND_MODE_COUNT ? blendMode : BLEND_MODE_NORMAL;
+
   JsonArray iarr = elem[F("i")]; //set individual LEDs
   if (!iarr.isNull()) {
     uint8_t oldMap1D2D = seg.map1D2D;
     seg.map1D2D = M12_Pixels; // no mapping
+    seg.allocatePixels();     // options may have changed segment size
+    seg.beginDraw();          // set up parameters for get/setPixelColor()
 
     // set brightness immediately and disable transition
     jsonTransitionOnce = true;
@@ -370,6 +375,7 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
   }
 
   if (root[F("psave")].isNull()) doReboot = root[F("rb")] | doReboot;
+  if (root[F("rstprof")]) Profiler::reset(); // restart the timing statistics in info.prof
 
   // do not allow changing main segment while in realtime mode (may get odd results else)
   if (!realtimeMode) strip.setMainSegmentId(root[F("mainseg")] | strip.getMainSegmentId()); // must be before realtimeLock() if "live"
@@ -565,6 +571,7 @@ void serializeSegment(const JsonObject& root, const Segment& seg, byte id, bool
   root["o3"]  = seg.check3;
   root["si"]  = seg.soundSim;
   root["m12"] = seg.map1D2D;
+  root["bm"]  = seg.blendMode;
 }
 
 void serializeState(JsonObject root, bool forPreset, bool includeBri, bool segmentBounds, bool selectedSegmentsOnly)
@@ -638,6 +645,8 @@ void serializeInfo(JsonObject root)
   leds[F("count")] = strip.getLengthTotal();
   leds[F("pwr")] = BusManager::currentMilliamps();
   leds["fps"] = strip.getFps();
+  leds[F("sent")] = BusManager::getFramesSent();    // bus updates sent
+  leds[F("skip")] = BusManager::getFramesSkipped(); // bus updates skipped as their LEDs did not change
   leds[F("maxpwr")] = BusManager::currentMilliamps()>0 ? BusManager::ablMilliampsMax() : 0;
   leds[F("maxseg")] = strip.getMaxSegments();
   //leds[F("actseg")] = strip.getActiveSegmentsNum();
@@ -777,6 +786,11 @@ void serializeInfo(JsonObject root)
   getTimeString(time);
   root[F("time")] = time;
 
+  #ifndef WLED_DISABLE_PROFILER
+  JsonObject prof = root.createNestedObject(F("prof"));
+  Profiler::serialize(prof);
+  #endif
+
   UsermodManager::addToJsonInfo(root);
 
   uint16_t os = 0;
@@ -0,0 +1,105 @@
+#include "wled.h"
+
+/*
+ * Main loop profiler, see profiler.h
+ */
+#ifndef WLED_DISABLE_PROFILER
+
+typedef struct ProfileHistogram {
+  uint32_t count[PROFILE_BUCKETS];
+  uint64_t total; // us
+  uint32_t max;   // us
+} profile_histogram_t;
+
+typedef struct ProfileStat {
+  uint32_t avg;   // us, moving average over about 16 calls
+  uint32_t max;   // us
+  uint32_t calls;
+  uint16_t id;    // effect or usermod ID
+} profile_stat_t;
+
+static profile_histogram_t histograms[PROFILE_TIMERS];
+static profile_stat_t segmentStats[MAX_NUM_SEGMENTS];
+static profile_stat_t usermodStats[WLED_MAX_USERMODS];
+
+static const char profileNames[PROFILE_TIMERS][8] PROGMEM = {
+  "loop", "jitter", "fx", "show", "bus", "net", "um"
+};
+
+static void addStat(profile_stat_t &s, uint32_t us) {
+  if (s.calls == 0) s.avg = us;
+  else s.avg += (int32_t(us) - int32_t(s.avg)) / 16;
+  if (us > s.max) s.max = us;
+  s.calls++;
+}
+
+void Profiler::add(ProfileTimer timer, uint32_t us) {
+  profile_histogram_t &h = histograms[timer];
+  uint32_t b = us / PROFILE_FIRST_BUCKET_US;
+  b = b ? 32 - __builtin_clz(b) : 0; // bucket n ends at 2^n times the first
+  h.count[b < PROFILE_BUCKETS ? b : PROFILE_BUCKETS - 1]++;
+  h.total += us;
+  if (us > h.max) h.max = us;
+}
+
+void Profiler::addSegment(unsigned id, uint8_t mode, uint32_t us) {
+  if (id >= MAX_NUM_SEGMENTS) return;
+  profile_stat_t &s = segmentStats[id];
+  if (s.id != mode || s.calls == 0) {
+    s = {}; // another effect, start over
+    s.id = mode;
+  }
+  addStat(s, us);
+}
+
+void Profiler::addUsermod(unsigned index, uint16_t id, uint32_t us) {
+  if (index >= WLED_MAX_USERMODS) return;
+  usermodStats[index].id = id;
+  addStat(usermodStats[index], us);
+}
+
+void Profiler::reset() {
+  memset(histograms, 0, sizeof(histograms));
+  memset(segmentStats, 0, sizeof(segmentStats));
+  memset(usermodStats, 0, sizeof(usermodStats));
+}
+
+void Profiler::serialize(JsonObject root) {
+  root[F("b0")] = PROFILE_FIRST_BUCKET_US; // upper bound of the first bucket in us
+  for (unsigned t = 0; t < PROFILE_TIMERS; t++) {
+    const profile_histogram_t &h = histograms[t];
+    JsonObject timer = root.createNestedObject(FPSTR(profileNames[t]));
+    uint32_t n = 0;
+    JsonArray counts = timer.createNestedArray("h");
+    for (unsigned b = 0; b < PROFILE_BUCKETS; b++) {
+      counts.add(h.count[b]);
+      n += h.count[b];
+    }
+    timer["n"]      = n;
+    timer[F("avg")] = n ? uint32_t(h.total / n) : 0;
+    timer[F("max")] = h.max;
+  }
+
+  JsonArray segs = root.createNestedArray("seg");
+  for (size_t s = 0; s < strip.getSegmentsNum() && s < MAX_NUM_SEGMENTS; s++) {
+    const profile_stat_t &st = segmentStats[s];
+    if (!strip.getSegment(s).isActive() || st.calls == 0) continue;
+    JsonObject seg = segs.createNestedObject();
+    seg["id"]     = s;
+    seg["fx"]     = st.id;
+    seg[F("avg")] = st.avg;
+    seg[F("max")] = st.max;
+  }
+
+  JsonArray ums = root.createNestedArray(F("mods"));
+  for (unsigned i = 0; i < UsermodManager::getModCount() && i < WLED_MAX_USERMODS; i++) {
+    const profile_stat_t &st = usermodStats[i];
+    if (st.calls == 0) continue;
+    JsonObject um = ums.createNestedObject();
+    um["id"]     = st.id;
+    um[F("avg")] = st.avg;
+    um[F("max")] = st.max;
+  }
+}
+
+#endif
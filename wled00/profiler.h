@@ -0,0 +1,48 @@
+#ifndef WLED_PROFILER_H
+#define WLED_PROFILER_H
+/*
+ * Timing of the main loop, effects, show() and usermods, kept as fixed bucket
+ * histograms so the frame budget can be checked on a running controller.
+ * Reported in /json/info ("prof") and streamed to a websocket client that
+ * sent {"prof":true}. Disable with -D WLED_DISABLE_PROFILER.
+ */
+#include <Arduino.h>
+#include "src/dependencies/json/ArduinoJson-v6.h"
+
+// bucket n counts times below PROFILE_FIRST_BUCKET_US << n microseconds,
+// the last bucket everything longer
+#define PROFILE_BUCKETS          10
+#define PROFILE_FIRST_BUCKET_US 128 // must be a power of two
+
+enum ProfileTimer : uint8_t {
+  PROFILE_LOOP,     // whole main loop
+  PROFILE_JITTER,   // lateness of a strip frame against the target frame time
+  PROFILE_EFFECTS,  // all effect functions of a frame
+  PROFILE_SHOW,     // strip.show() including the show callback
+  PROFILE_BUS,      // BusManager::show(), i.e. the LED data transfer
+  PROFILE_NETWORK,  // WiFi connection, UDP notifications/realtime, websockets
+  PROFILE_USERMODS, // userLoop() and all usermod loops
+  PROFILE_TIMERS
+};
+
+#ifndef WLED_DISABLE_PROFILER
+namespace Profiler {
+  void add(ProfileTimer timer, uint32_t us);
+  // effect time of one segment, statistics restart when the effect changes
+  void addSegment(unsigned id, uint8_t mode, uint32_t us);
+  // loop() time of the usermod registered at index
+  void addUsermod(unsigned index, uint16_t id, uint32_t us);
+  void reset();
+  void serialize(JsonObject root);
+};
+#else
+namespace Profiler {
+  inline void add(ProfileTimer timer, uint32_t us) {}
+  inline void addSegment(unsigned id, uint8_t mode, uint32_t us) {}
+  inline void addUsermod(unsigned index, uint16_t id, uint32_t us) {}
+  inline void reset() {}
+  inline void serialize(JsonObject root) {}
+};
+#endif
+
+#endif
@@ -415,6 +415,8 @@ void realtimeLock(uint32_t timeoutMs, byte md)
       start = mainseg.start;
       stop  = mainseg.stop;
       mainseg.freeze = true;
+      mainseg.beginDraw(); // set up parameters for fill()
+      mainseg.fill(BLACK); // pixel buffer is shown instead of the effect
       // if WLED was off and using main segment only, freeze non-main segments so they stay off
       if (bri == 0) {
         for (size_t s = 0; s < strip.getSegmentsNum(); s++) {
@@ -481,6 +483,7 @@ void handleNotifications()
   if (e131NewData && millis() - strip.getLastShow() > 15)
   {
     e131NewData = false;
+    UsermodManager::onRealtimeShow();
     strip.show();
   }
 
@@ -629,31 +632,20 @@ void handleNotifications()
       }
     } else if (udpIn[0] == 2 && packetSize > 4) //drgb
     {
-      for (size_t i = 2, id = 0; i < packetSize -2 && id < totalLen; i += 3, id++)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-      }
+      setRealtimePixels(0, udpIn + 2, min(unsigned(packetSize - 2) / 3, totalLen));
     } else if (udpIn[0] == 3 && packetSize > 6) //drgbw
     {
-      for (size_t i = 2, id = 0; i < packetSize -3 && id < totalLen; i += 4, id++)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], udpIn[i+3]);
-      }
+      setRealtimePixels(0, udpIn + 2, min(unsigned(packetSize - 2) / 4, totalLen), true);
     } else if (udpIn[0] == 4 && packetSize > 7) //dnrgb
     {
       unsigned id = ((udpIn[3] << 0) & 0xFF) + ((udpIn[2] << 8) & 0xFF00);
-      for (size_t i = 4; i < packetSize -2 && id < totalLen; i += 3, id++)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-      }
+      if (id < totalLen) setRealtimePixels(id, udpIn + 4, min(unsigned(packetSize - 4) / 3, totalLen - id));
     } else if (udpIn[0] == 5 && packetSize > 8) //dnrgbw
     {
       unsigned id = ((udpIn[3] << 0) & 0xFF) + ((udpIn[2] << 8) & 0xFF00);
-      for (size_t i = 4; i < packetSize -2 && id < totalLen; i += 4, id++)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], udpIn[i+3]);
-      }
+      if (id < totalLen) setRealtimePixels(id, udpIn + 4, min(unsigned(packetSize - 4) / 4, totalLen - id), true);
     }
+    UsermodManager::onRealtimeShow();
     strip.show();
     return;
   }
@@ -695,6 +687,23 @@ void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w)
   }
 }
 
+// writes count packed RGB (or RGBW) pixels starting at realtime index i
+// takes the bulk bus path unless gamma correction, main segment mode or a negative offset need per pixel handling
+void setRealtimePixels(uint16_t i, const uint8_t *data, unsigned count, bool rgbw)
+{
+  UsermodManager::onRealtimePixels(i, data, count, rgbw);
+  int pix = i + arlsOffset;
+  if (pix < 0 || useMainSegmentOnly || (!arlsDisableGammaCorrection && gammaCorrectCol)) {
+    const unsigned stride = 3 + rgbw;
+    for (unsigned n = 0; n < count; n++, data += stride) setRealtimePixel(i + n, data[0], data[1], data[2], rgbw ? data[3] : 0);
+    return;
+  }
+  unsigned total = strip.getLengthTotal();
+  if (unsigned(pix) >= total) return;
+  if (count > total - pix) count = total - pix;
+  strip.setPixelsRGB(pix, data, count, rgbw);
+}
+
 /*********************************************************************************************\
    Refresh aging for remote units, drop if too old...
 \*********************************************************************************************/
@@ -9,7 +9,13 @@ byte UsermodManager::numMods = 0;
 //Usermod Manager internals
 void UsermodManager::setup()             { for (unsigned i = 0; i < numMods; i++) ums[i]->setup(); }
 void UsermodManager::connected()         { for (unsigned i = 0; i < numMods; i++) ums[i]->connected(); }
-void UsermodManager::loop()              { for (unsigned i = 0; i < numMods; i++) ums[i]->loop();  }
+void UsermodManager::loop() {
+  for (unsigned i = 0; i < numMods; i++) {
+    unsigned long t = micros();
+    ums[i]->loop();
+    Profiler::addUsermod(i, ums[i]->getId(), micros() - t);
+  }
+}
 void UsermodManager::handleOverlayDraw() { for (unsigned i = 0; i < numMods; i++) ums[i]->handleOverlayDraw(); }
 void UsermodManager::appendConfigData(Print& dest)  { for (unsigned i = 0; i < numMods; i++) ums[i]->appendConfigData(dest); }
 bool UsermodManager::handleButton(uint8_t b) {
@@ -52,6 +58,8 @@ bool UsermodManager::onEspNowMessage(uint8_t* sender, uint8_t* payload, uint8_t
 #endif
 void UsermodManager::onUpdateBegin(bool init) { for (unsigned i = 0; i < numMods; i++) ums[i]->onUpdateBegin(init); } // notify usermods that update is to begin
 void UsermodManager::onStateChange(uint8_t mode) { for (unsigned i = 0; i < numMods; i++) ums[i]->onStateChange(mode); } // notify usermods that WLED state changed
+void UsermodManager::onRealtimePixels(unsigned start, const uint8_t* data, unsigned count, bool rgbw) { for (unsigned i = 0; i < numMods; i++) ums[i]->onRealtimePixels(start, data, count, rgbw); }
+void UsermodManager::onRealtimeShow() { for (unsigned i = 0; i < numMods; i++) ums[i]->onRealtimeShow(); }
 
 /*
  * Enables usermods to lookup another Usermod.
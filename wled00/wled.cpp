@@ -52,17 +52,22 @@ void WLED::loop()
   static size_t        avgStripMillis = 0;
   unsigned long        stripMillis;
 #endif
+  unsigned long loopMicros = micros();
 
   handleTime();
   #ifndef WLED_DISABLE_INFRARED
   handleIR();        // 2nd call to function needed for ESP32 to return valid results -- should be good for ESP8266, too
   #endif
+  unsigned long netMicros = micros();
   handleConnection();
+  netMicros = micros() - netMicros;
   #ifdef WLED_ENABLE_ADALIGHT
   handleSerial();
   #endif
   handleImprovWifiScan();
+  unsigned long notifyMicros = micros();
   handleNotifications();
+  netMicros += micros() - notifyMicros;
   handleTransitions();
   #ifdef WLED_ENABLE_DMX
   handleDMXOutput();
@@ -74,8 +79,10 @@ void WLED::loop()
   #ifdef WLED_DEBUG
   unsigned long usermodMillis = millis();
   #endif
+  unsigned long usermodMicros = micros();
   userLoop();
   UsermodManager::loop();
+  Profiler::add(PROFILE_USERMODS, micros() - usermodMicros);
   #ifdef WLED_DEBUG
   usermodMillis = millis() - usermodMillis;
   avgUsermodMillis += usermodMillis;
@@ -200,7 +207,9 @@ void WLED::loop()
   if (doSerializeConfig) serializeConfig();
 
   yield();
+  unsigned long wsMicros = micros();
   handleWs();
+  Profiler::add(PROFILE_NETWORK, netMicros + micros() - wsMicros);
 #if defined(STATUSLED)
   handleStatusLED();
 #endif
@@ -223,6 +232,8 @@ void WLED::loop()
   if (doReboot && (!doInitBusses || !doSerializeConfig)) // if busses have to be inited & saved, wait until next iteration
     reset();
 
+  Profiler::add(PROFILE_LOOP, micros() - loopMicros);
+
 // DEBUG serial logging (every 30s)
 #ifdef WLED_DEBUG
   loopMillis = millis() - loopMillis;
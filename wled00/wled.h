@@ -190,6 +190,7 @@ using PSRAMDynamicJsonDocument = BasicJsonDocument<PSRAM_Allocator>;
 #include "NodeStruct.h"
 #include "pin_manager.h"
 #include "bus_manager.h"
+#include "profiler.h"
 #include "FX.h"
 
 #ifndef CLIENT_SSID
@@ -8,8 +8,13 @@
 uint16_t wsLiveClientId = 0;
 unsigned long wsLastLiveTime = 0;
 //uint8_t* wsFrameBuffer = nullptr;
+#ifndef WLED_DISABLE_PROFILER
+uint16_t wsProfileClientId = 0;
+unsigned long wsLastProfileTime = 0;
+#endif
 
 #define WS_LIVE_INTERVAL 40
+#define WS_PROFILE_INTERVAL 1000
 
 void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)
 {
@@ -20,6 +25,9 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
   } else if(type == WS_EVT_DISCONNECT){
     //client disconnected
     if (client->id() == wsLiveClientId) wsLiveClientId = 0;
+    #ifndef WLED_DISABLE_PROFILER
+    if (client->id() == wsProfileClientId) wsProfileClientId = 0;
+    #endif
     DEBUG_PRINTLN(F("WS client disconnected."));
   } else if(type == WS_EVT_DATA){
     // data packet
@@ -52,6 +60,11 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
           verboseResponse = true;
         } else if (root.containsKey("lv")) {
           wsLiveClientId = root["lv"] ? client->id() : 0;
+        #ifndef WLED_DISABLE_PROFILER
+        } else if (root.containsKey("prof")) {
+          wsProfileClientId = root["prof"] ? client->id() : 0;
+          wsLastProfileTime = 0; // send the first timing report right away
+        #endif
         } else {
           verboseResponse = deserializeState(root);
         }
@@ -219,6 +232,28 @@ bool sendLiveLedsWs(uint32_t wsClient)
   return true;
 }
 
+#ifndef WLED_DISABLE_PROFILER
+// main loop timing (see profiler.h) for the client that sent {"prof":true}
+bool sendProfileWs(uint32_t wsClient)
+{
+  AsyncWebSocketClient * wsc = ws.client(wsClient);
+  if (!wsc || wsc->queueLength() > 0) return false; //only send if queue free
+  if (!requestJSONBufferLock(23)) return false;
+
+  JsonObject prof = pDoc->createNestedObject(F("prof"));
+  Profiler::serialize(prof);
+  size_t len = measureJson(*pDoc);
+  AsyncWebSocketBuffer buffer(len);
+  bool sent = (bool)buffer;
+  if (sent) {
+    serializeJson(*pDoc, (char *)buffer.data(), len);
+    wsc->text(std::move(buffer));
+  }
+  releaseJSONBufferLock();
+  return sent;
+}
+#endif
+
 void handleWs()
 {
   if (millis() - wsLastLiveTime > WS_LIVE_INTERVAL)
@@ -233,6 +268,11 @@ void handleWs()
     wsLastLiveTime = millis();
     if (!success) wsLastLiveTime -= 20; //try again in 20ms if failed due to non-empty WS queue
   }
+  #ifndef WLED_DISABLE_PROFILER
+  if (wsProfileClientId && millis() - wsLastProfileTime > WS_PROFILE_INTERVAL) {
+    if (sendProfileWs(wsProfileClientId)) wsLastProfileTime = millis();
+  }
+  #endif
 }
 
 #else